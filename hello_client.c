@@ -36,9 +36,11 @@
 * Bluetooth LE Vendor Specific Client Device
 *
 * The Hello Client application is designed to connect and access services
-* of the Hello Sensor device.  Because handles of the all attributes of
-* the Hello Sensor are well known, Hello Client does not perform GATT
-* discovery, but uses them directly.  In addition to that Hello Client
+* of the Hello Sensor device.  Hello Client discovers handles of the Hello
+* Sensor on the first connection and saves them in the NVRAM, so that
+* reconnection goes straight to the registration for notifications.  If
+* discovery fails, well known handles of the Hello Sensor are used.  In
+* addition to that Hello Client
 * allows another central to connect, so the device will behave as a peripheral
 * in one Bluetooth piconet and a central in another.  To accomplish that
 * application can do both advertisements and scans.  Hello Client assumes
@@ -59,8 +61,8 @@
 * 3. Connect from some client application (for example LightBlue on iOS)
 * 4. From the client application register for notifications
 * 5. Make sure that your peripheral device (hello_sensor) is up and advertising
-* 6. Push the user button on the board for 6 seconds.  That will start
-*    connection process.
+* 6. Hello Client starts looking for the sensors at power up, and keeps
+*    looking as long as it has free links.
 * 7. Push the user button on the hello_sensor to deliver notification through
 *    hello_client device up to the client.
 *
@@ -81,23 +83,251 @@
 #include "lel2cap.h"
 #include "sparcommon.h"
 
-const UINT8 hello_service[16] = {UUID_HELLO_SERVICE};
+const UINT8 hello_service[16]               = {UUID_HELLO_SERVICE};
+const UINT8 hello_characteristic_notify[16] = {UUID_HELLO_CHARACTERISTIC_NOTIFY};
+const UINT8 hello_characteristic_config[16] = {UUID_HELLO_CHARACTERISTIC_CONFIG};
 
 /******************************************************
  *                      Constants
  ******************************************************/
-#define NVRAM_ID_HOST_LIST              0x10    // ID of the memory block used for NVRAM access
+#define NVRAM_ID_HOST_LIST              0x10    // ID of the memory block used to save host info of the bonded centrals
+#define NVRAM_ID_PEER_CACHE             0x11    // first ID of the blocks used to save sensor handles
+#define NVRAM_ID_CONFIG                 0x19    // ID of the memory block used to save the runtime configuration
 
 #define CONNECT_ANY                     0x01
 #define CONNECT_HELLO_SENSOR            0x02
 #define SMP_PAIRING                     0x04
 #define SMP_ERASE_KEY                   0x08
+#define RELAY_AGGREGATE                 0x10
+#define AUTO_RECONNECT                  0x20
+#define RELAY_SEGMENTED                 0x40
 
+// Connections held at the same time, each keeps full device info and SMP state.  Sensors of
+// the roster beyond that take turns, a link idle for a while is given to a waiting sensor.
 #define HELLO_CLIENT_MAX_PERIPHERALS    4
+#define HELLO_CLIENT_MAX_SENSORS        8
+
+// Centrals connected at the same time, each takes a link from the pool
+#define HELLO_CLIENT_MAX_CENTRALS       2
 
 #define RMULP_CONN_HANDLE_START         0x40
+#define HELLO_CLIENT_CONN_HANDLE_RANGE  16      // connection handles from RMULP_CONN_HANDLE_START mapped to links
+#define HELLO_CLIENT_NO_LINK            0xff    // connection handle is not mapped to a link
 #define CENTRAL_ROLE                    0
 #define PERIPHERAL_ROLE                 1
+#define NO_ROLE                         0xff    // connection is down
+
+#define HELLO_CLIENT_RELAY_MAX_LEN      20      // max value length in a single notification with default ATT MTU
+#define HELLO_CLIENT_ATT_DEFAULT_MTU    23
+#define HELLO_CLIENT_ATT_HDR_LEN        3       // opcode and handle of the notification
+
+// Fine timer runs the aggregation deadline, the relay and command retries and the short
+// timeouts, 100 ms so that aggregated data is not held for a second.  It ticks only while
+// the timers run, they are stopped while the client is idle, and with a link up the device
+// already wakes for the connection events, so the extra cost is the handler run on ticks
+// between them.
+#define HELLO_CLIENT_FINE_TIMER_INTERVAL  100   // ms
+
+// In the RELAY_AGGREGATE mode data from peripherals is packed into one upstream PDU as records
+// of the connection handle (1 byte), length (1 byte) and data.
+#define HELLO_CLIENT_AGGR_HDR_LEN           2
+#define HELLO_CLIENT_AGGR_FLUSH_THRESHOLD   16  // send aggregated PDU when it has this many bytes
+#define HELLO_CLIENT_AGGR_FLUSH_TICKS       1   // send aggregated PDU not later than in this number of fine timer ticks
+
+// Version of the runtime configuration record.  Record of another version read from the
+// NVRAM is ignored, write of a single 0 byte restores the configuration of the build.
+#define HELLO_CLIENT_CONFIG_VERSION         1
+
+// Data which cannot be sent to the central right away is kept in a queue of each peripheral
+#define HELLO_CLIENT_RELAY_QUEUE_DEPTH      4
+#define HELLO_CLIENT_CONFIRM_HOLD_TICKS     50  // fine timer ticks, well below the 30 s ATT timeout of the sensor
+
+// Host info changed by the central is written to the NVRAM when it did not change for a while
+#define HELLO_CLIENT_HOSTINFO_FLUSH_DELAY   2   // seconds
+#define HELLO_CLIENT_MAX_HOSTS              4   // centrals which client configuration is remembered
+#define HELLO_CLIENT_NO_HOST                0xff    // central link is not encrypted yet, nothing restored or saved
+
+// In the RELAY_SEGMENTED mode sensor records larger than one notification are reassembled
+// in a buffer of the pool, and sent to the central segmented for the central link
+#define HELLO_CLIENT_REASM_POOL_SIZE        2
+#define HELLO_CLIENT_REASM_MAX_LEN          128
+#define HELLO_CLIENT_REASM_TIMEOUT          10  // fine timer ticks to receive the next segment
+#define HELLO_CLIENT_REASM_NONE             0xff
+
+// states of the reassembly buffer
+#define HELLO_CLIENT_REASM_FREE             0
+#define HELLO_CLIENT_REASM_RECEIVING        1
+#define HELLO_CLIENT_REASM_SENDING          2
+
+// Central writes commands to the data characteristic as the target connection mux index
+// (1 byte) followed by the value for the configuration characteristic of the sensor.  With
+// the target HELLO_CLIENT_CMD_TARGET_PRIORITY it is the connection mux index followed by
+// the priority class of the sensor, which is saved with the sensor handles.
+#define HELLO_CLIENT_CMD_TARGET_ALL         0xff
+#define HELLO_CLIENT_CMD_TARGET_PRIORITY    0xfe
+#define HELLO_CLIENT_CMD_MAX_LEN            (HELLO_CLIENT_RELAY_MAX_LEN - 1)
+#define HELLO_CLIENT_CMD_QUEUE_DEPTH        4
+#define HELLO_CLIENT_WRITE_TIMEOUT          2   // seconds to wait for the write response of the sensor
+
+// Priority classes of the sensors.  Queues of the alarm sensors are served before others,
+// the rest share the central link by deficit round robin, quantum in bytes per round.
+#define HELLO_CLIENT_PRIORITY_ALARM         0
+#define HELLO_CLIENT_PRIORITY_NORMAL        1
+#define HELLO_CLIENT_PRIORITY_BULK          2
+#define HELLO_CLIENT_PRIORITY_NUM           3
+#define HELLO_CLIENT_QUANTUM_NORMAL         (2 * HELLO_CLIENT_RELAY_MAX_LEN)
+#define HELLO_CLIENT_QUANTUM_BULK           HELLO_CLIENT_RELAY_MAX_LEN
+
+// Advertisers which do not publish the Hello Sensor service are remembered and skipped
+#define HELLO_CLIENT_ADV_CACHE_SIZE         8
+#define HELLO_CLIENT_ADV_CACHE_MISSES       2   // reports without the service before advertiser is skipped
+#define HELLO_CLIENT_ADV_CACHE_TIMEOUT      10  // seconds, cache is cleared to let advertisers change their data
+
+// event types of the advertising report, scan response follows the scannable advertisement
+#define HELLO_CLIENT_ADV_IND                0x00
+#define HELLO_CLIENT_ADV_SCAN_IND           0x02
+#define HELLO_CLIENT_ADV_SCAN_RSP           0x04
+
+// Handles discovered on the sensors are saved in the NVRAM, so that reconnection does not need discovery
+#define HELLO_CLIENT_PEER_CACHE_SIZE        HELLO_CLIENT_MAX_SENSORS
+#define HELLO_CLIENT_DISCOVERY_TIMEOUT      5   // seconds
+
+// discovery states of the peripheral connection
+#define HELLO_CLIENT_DISC_IDLE              0
+#define HELLO_CLIENT_DISC_SERVICE           1   // looking for the Hello Sensor service
+#define HELLO_CLIENT_DISC_CHARACTERISTICS   2   // looking for the measurement and configuration characteristics
+#define HELLO_CLIENT_DISC_DESCRIPTOR        3   // looking for the measurement client configuration descriptor
+#define HELLO_CLIENT_DISC_VERIFY            4   // registered for notifications with cached handles
+#define HELLO_CLIENT_DISC_DONE              5
+
+// Indication round trip is timed with the fine timer, a sample is a whole number of
+// HELLO_CLIENT_FINE_TIMER_INTERVAL ticks, so round trips of a few connection intervals are
+// 0 or 1 tick.  indication_rtt is the running average of the samples, which keeps the
+// fraction of a tick, and is meaningful only over many indications.
+#define HELLO_CLIENT_STATS_RTT_SHIFT        3   // weight of the new sample in the average indication round trip time
+
+// RSSI of the sensor links is sampled and averaged.  Link which stays weak is dropped
+// before the supervision timeout, and the roster sensors are reconnected right away.
+#define HELLO_CLIENT_RSSI_SAMPLE_TICKS      5   // fine timer ticks between the samples
+#define HELLO_CLIENT_RSSI_SHIFT             2   // weight of the new sample in the average
+#define HELLO_CLIENT_RSSI_WEAK              -88 // dBm
+#define HELLO_CLIENT_RSSI_WEAK_SAMPLES      3   // samples with weak average before link is dropped
+#define HELLO_CLIENT_RSSI_MIN_LINK_TIME     100 // fine timer ticks, link is not dropped sooner after it is up
+#define HELLO_CLIENT_RSSI_INVALID           127
+
+// Sensors found during the window which starts with the first sensor found are connected in order of RSSI
+#define HELLO_CLIENT_CANDIDATE_WINDOW       5   // fine timer ticks
+
+// Low scan interval is doubled every time low scan expires without finding a sensor
+#define HELLO_CLIENT_LOW_SCAN_INTERVAL_MAX  16384   // slots, max LE scan interval
+
+// States of looking for the sensors.  Security, discovery and registration of each sensor
+// follow in the disc_state of its link.
+#define HELLO_CLIENT_STATE_IDLE             0   // not started
+#define HELLO_CLIENT_STATE_RECONNECT        1   // connecting to any roster sensor in the accept list
+#define HELLO_CLIENT_STATE_SCAN             2   // scanning for the sensors
+#define HELLO_CLIENT_STATE_CONNECT          3   // connecting to a sensor found in the scan
+#define HELLO_CLIENT_STATE_FULL             4   // all links are used, scan only for a sensor which can take a link
+
+// events which move the state
+#define HELLO_CLIENT_EVENT_START            0   // application is ready
+#define HELLO_CLIENT_EVENT_LINK_UP          1   // sensor connected
+#define HELLO_CLIENT_EVENT_LINK_DOWN        2   // sensor disconnected
+#define HELLO_CLIENT_EVENT_CANDIDATES       3   // sensors found in the scan are ready to be connected
+#define HELLO_CLIENT_EVENT_SCAN_TIMEOUT     4
+#define HELLO_CLIENT_EVENT_CONN_TIMEOUT     5
+
+// traffic levels of a connection used to select connection parameters
+#define HELLO_CLIENT_TRAFFIC_IDLE           0
+#define HELLO_CLIENT_TRAFFIC_NORMAL         1
+#define HELLO_CLIENT_TRAFFIC_BURST          2
+
+#define HELLO_CLIENT_BURST_RATE             8   // notifications per second which make the link busy
+#define HELLO_CLIENT_IDLE_TIME              10  // seconds without notifications which make the link idle
+#define HELLO_CLIENT_CONN_UPDATE_HOLDOFF    5   // seconds between connection parameter update requests
+
+#define HELLO_CLIENT_ROTATE_IDLE_TIME       30  // seconds without data before the link can be given to another sensor
+#define HELLO_CLIENT_ROTATE_HOLDOFF         30  // seconds sensor which gave up the link is not connected again
+#define HELLO_CLIENT_RECONNECT_HOLDOFF      10  // seconds after a timed out accept list connection before the next one
+
+// Trace level of the notification, indication, advertisement and write handlers
+//  0 - traces are compiled out
+//  1 - traces are saved in RAM and printed from the application timer, data is not dumped
+//  2 - traces are printed to the PUART right away
+#ifndef HELLO_CLIENT_TRACE_LEVEL
+#ifdef WICED_BT_TRACE_ENABLE
+#define HELLO_CLIENT_TRACE_LEVEL        2
+#else
+#define HELLO_CLIENT_TRACE_LEVEL        0
+#endif
+#endif
+
+#define HELLO_CLIENT_TRACE_BUF_SIZE     16      // number of deferred traces kept until the application timer
+
+#if HELLO_CLIENT_TRACE_LEVEL == 2
+#define HELLO_CLIENT_TRACE0(fmt)            ble_trace0(fmt)
+#define HELLO_CLIENT_TRACE1(fmt, a)         ble_trace1(fmt, a)
+#define HELLO_CLIENT_TRACE2(fmt, a, b)      ble_trace2(fmt, a, b)
+#define HELLO_CLIENT_TRACEN(p, len)         ble_tracen((char *)(p), len)
+#elif HELLO_CLIENT_TRACE_LEVEL == 1
+#define HELLO_CLIENT_TRACE0(fmt)            hello_client_trace_defer(fmt, 0, 0)
+#define HELLO_CLIENT_TRACE1(fmt, a)         hello_client_trace_defer(fmt, (UINT32)(a), 0)
+#define HELLO_CLIENT_TRACE2(fmt, a, b)      hello_client_trace_defer(fmt, (UINT32)(a), (UINT32)(b))
+#define HELLO_CLIENT_TRACEN(p, len)
+#else
+#define HELLO_CLIENT_TRACE0(fmt)
+#define HELLO_CLIENT_TRACE1(fmt, a)
+#define HELLO_CLIENT_TRACE2(fmt, a, b)
+#define HELLO_CLIENT_TRACEN(p, len)
+#endif
+
+// Profiling build keeps cycle counts of the callbacks, taken from the DWT cycle counter of
+// the Cortex-M3.  Counters are read over the statistics characteristic by writing
+// HELLO_CLIENT_PROFILE_SELECT plus the callback ID, and are also printed to the PUART.
+#if defined(HELLO_CLIENT_PROFILE) || defined(HELLO_CLIENT_BENCH)
+#define HELLO_CLIENT_DEMCR                  (*(volatile UINT32 *)0xE000EDFC)
+#define HELLO_CLIENT_DWT_CTRL               (*(volatile UINT32 *)0xE0001000)
+#define HELLO_CLIENT_DWT_CYCCNT             (*(volatile UINT32 *)0xE0001004)
+#define HELLO_CLIENT_CYCLES()               HELLO_CLIENT_DWT_CYCCNT
+#endif
+
+#ifdef HELLO_CLIENT_PROFILE
+#define HELLO_CLIENT_PROFILED(func)         func##_profiled
+#else
+#define HELLO_CLIENT_PROFILED(func)         func
+#endif
+
+#define HELLO_CLIENT_PROFILE_CONN_UP        0
+#define HELLO_CLIENT_PROFILE_CONN_DOWN      1
+#define HELLO_CLIENT_PROFILE_NOTIFICATION   2
+#define HELLO_CLIENT_PROFILE_INDICATION     3
+#define HELLO_CLIENT_PROFILE_ADV_REPORT     4
+#define HELLO_CLIENT_PROFILE_WRITE          5
+#define HELLO_CLIENT_PROFILE_APP_TIMER      6
+#define HELLO_CLIENT_PROFILE_FINE_TIMER     7
+#define HELLO_CLIENT_PROFILE_TIMER_CALLBACK 8
+#define HELLO_CLIENT_PROFILE_NUM            9
+
+#define HELLO_CLIENT_PROFILE_SELECT         0x80
+
+// Benchmark build drives the traffic generators of the hello_sensor peers at each rate of
+// hello_client_bench_rate on one sensor, then on two and so on up to the sensors connected.
+// Throughput, dwell time percentiles, drops and reconnect times of each step are printed to
+// the PUART.  Dwell time is the time a frame spends in the client, from its reception to its
+// send to the central, taken from the cycle counter, so the device does not sleep in this
+// build.  Time over the air is not included, sensor clock is not synchronized with the client.
+#ifdef HELLO_CLIENT_BENCH
+#define HELLO_CLIENT_BENCH_STEP_TIME        10  // seconds
+#define HELLO_CLIENT_BENCH_START_DELAY      5   // seconds with a central and a sensor before the first step
+#define HELLO_CLIENT_BENCH_CYCLES_PER_MS    24000   // CPU clock of the 20736
+#define HELLO_CLIENT_BENCH_BUCKETS          12  // dwell time histogram, bucket n counts times below 2^n ms
+#define HELLO_CLIENT_BENCH_NUM_RATES        (sizeof(hello_client_bench_rate) / sizeof(hello_client_bench_rate[0]))
+
+// states of the benchmark
+#define HELLO_CLIENT_BENCH_IDLE             0
+#define HELLO_CLIENT_BENCH_RUNNING          1
+#define HELLO_CLIENT_BENCH_DONE             2
+#endif
 
 /******************************************************
  *                     Structures
@@ -113,8 +343,251 @@ typedef PACKED struct
     UINT16  characteristic_client_configuration;
 
 }  HOSTINFO;
+
+// word access to the unaligned UUID and BD address in the advertisement report
+typedef PACKED struct
+{
+    UINT32  w[4];
+} UUID128_WORDS;
+
+typedef PACKED struct
+{
+    UINT32  lo;
+    UINT16  hi;
+} BD_ADDR_WORDS;
+
+// sensor handles for NVRAM
+typedef PACKED struct
+{
+    BD_ADDR bdaddr;
+    UINT16  service_start_handle;
+    UINT16  service_end_handle;
+    UINT16  data_handle;
+    UINT16  config_handle;
+    UINT16  data_descriptor_handle;
+    UINT8   config_properties;
+    UINT8   addr_type;
+    UINT8   priority;                   // one of the HELLO_CLIENT_PRIORITY_ classes
+    UINT8   hash;                       // hash of the record, has to be the last
+} HELLO_CLIENT_PEER_CACHE;
+
+// value of the statistics characteristic
+typedef PACKED struct
+{
+    UINT8   index;                      // connection mux index selected by the peer
+    UINT8   role;                       // CENTRAL_ROLE, PERIPHERAL_ROLE or NO_ROLE
+    UINT16  notifications_in;
+    UINT16  notifications_out;
+    UINT16  drops;
+    UINT32  bytes_in;
+    UINT32  bytes_out;
+    UINT16  indication_rtt;             // ms, average over many indications
+    UINT16  first_notification_time;    // ms since connection up
+} HELLO_CLIENT_STATS_RECORD;
+
+// value of the configuration characteristic, saved in the NVRAM and applied when written
+typedef PACKED struct
+{
+    UINT8   version;                    // HELLO_CLIENT_CONFIG_VERSION
+    UINT16  high_scan_interval;         // slots
+    UINT16  high_scan_window;           // slots
+    UINT16  low_scan_interval;          // slots, starting value of the low scan back off
+    UINT16  low_scan_window;            // slots
+    UINT16  high_conn_min_interval;     // frames
+    UINT16  high_conn_max_interval;     // frames
+    UINT16  high_supervision_timeout;   // N * 10ms
+    UINT16  low_supervision_timeout;    // N * 10ms
+    UINT16  aggr_flush_threshold;       // bytes
+    UINT8   aggr_flush_ticks;           // fine timer ticks
+} HELLO_CLIENT_CONFIG_RECORD;
+
+// value of the statistics characteristic when a callback is selected in the profiling build
+typedef PACKED struct
+{
+    UINT8   index;                      // HELLO_CLIENT_PROFILE_SELECT plus the callback ID
+    UINT32  count;
+    UINT32  min;                        // cycles
+    UINT32  avg;                        // cycles
+    UINT32  max;                        // cycles
+} HELLO_CLIENT_PROFILE_RECORD;
 #pragma pack()
 
+// data received from a peripheral waiting to be sent to the central
+typedef struct
+{
+    UINT8   con_handle;                 // connection handle of the peripheral which sent the data
+    UINT8   len;
+    UINT8   data[HELLO_CLIENT_RELAY_MAX_LEN];
+#ifdef HELLO_CLIENT_BENCH
+    UINT32  arrival;                    // cycle count when the data was received
+#endif
+} HELLO_CLIENT_RELAY_ENTRY;
+
+typedef struct
+{
+    HELLO_CLIENT_RELAY_ENTRY entry[HELLO_CLIENT_RELAY_QUEUE_DEPTH];
+    UINT8   head;                       // index of the oldest entry
+    UINT8   count;                      // number of entries in the queue
+    UINT16  deficit;                    // bytes the queue can still send in this round
+} HELLO_CLIENT_RELAY_QUEUE;
+
+// counters of a connection
+typedef struct
+{
+    UINT8   role;                       // CENTRAL_ROLE, PERIPHERAL_ROLE or NO_ROLE
+    UINT16  notifications_in;           // notifications and indications received from the peripheral
+    UINT16  notifications_out;          // notifications and indications sent to the central
+    UINT16  drops;                      // data from the peripheral dropped because the queue was full
+    UINT32  bytes_in;
+    UINT32  bytes_out;
+    UINT32  conn_up_time;               // fine timer count when connection was established
+    UINT16  first_notification_time;    // fine timer ticks from connection up to the first notification
+    UINT32  indication_sent_time;       // fine timer count when indication was sent
+    UINT16  indication_rtt;             // average indication round trip time, fine timer ticks << HELLO_CLIENT_STATS_RTT_SHIFT
+
+    UINT16  notifications_last;         // notifications count a second ago
+    UINT8   idle_time;                  // seconds without notifications, up to 255
+    UINT8   traffic;                    // one of the HELLO_CLIENT_TRAFFIC_ levels
+
+    INT16   rssi_avg;                   // average RSSI, dBm << HELLO_CLIENT_RSSI_SHIFT
+    UINT8   rssi_samples;               // samples taken, up to 255
+    UINT8   rssi_weak;                  // consecutive samples with weak average
+} HELLO_CLIENT_LINK_STATS;
+
+// connection parameters requested from the central
+typedef struct
+{
+    UINT16  min_interval;               // 1.25 ms
+    UINT16  max_interval;               // 1.25 ms
+    UINT16  latency;                    // number of connection events
+    UINT16  timeout;                    // 10 ms
+} HELLO_CLIENT_CONN_PARAMS;
+
+// Hello Sensor connected as a peripheral
+typedef struct
+{
+    BD_ADDR bdaddr;
+    UINT8   addr_type;
+    UINT16  con_handle;
+    UINT8   disc_state;                 // one of the HELLO_CLIENT_DISC_ states
+    UINT32  disc_start;                 // app timer count when discovery started
+
+    UINT16  service_start_handle;       // range of the Hello Sensor service
+    UINT16  service_end_handle;
+    UINT16  data_handle;                // handle of the sensor's measurement characteristic
+    UINT16  config_handle;              // handle of the sensor's configuration characteristic
+    UINT16  data_descriptor_handle;     // handle of the measurements client configuration descriptor
+    UINT8   config_properties;          // properties of the configuration characteristic
+    BOOL    write_outstanding;          // write request sent to the sensor is not responded yet
+    UINT32  write_start;                // app timer count when the write request was sent
+    BOOL    confirm_held;               // indication from the sensor is not confirmed until its queue has space
+    UINT32  confirm_held_time;          // fine timer count when the confirmation was held
+    UINT8   priority;                   // one of the HELLO_CLIENT_PRIORITY_ classes
+} HELLO_CLIENT_PEER;
+
+// sensor record being reassembled or sent to the central
+typedef struct
+{
+    UINT8   state;                      // one of the HELLO_CLIENT_REASM_ states
+    UINT8   cm_index;                   // link which sends the record
+    UINT8   seq;                        // sequence number of the next segment received or sent
+    UINT16  len;
+    UINT16  sent;                       // bytes already sent to the central
+    UINT32  deadline;                   // fine timer count when the next segment has to be received
+    UINT8   data[HELLO_CLIENT_REASM_MAX_LEN];
+} HELLO_CLIENT_REASM_BUF;
+
+// command from the central waiting to be written to the sensors
+typedef struct
+{
+    UINT8   pending;                    // bit mask of connection mux indexes command is not written to yet
+    UINT8   len;
+    UINT8   data[HELLO_CLIENT_CMD_MAX_LEN];
+} HELLO_CLIENT_CMD_ENTRY;
+
+// context of a connection, indexed by the connection mux index
+typedef struct
+{
+    // device info and smp_info saved for the connection mux
+    EMCONINFO_DEVINFO        dev_info;
+    LESMP_INFO               smp_info;
+    HELLO_CLIENT_LINK_STATS  stats;
+    HELLO_CLIENT_PEER        peer;          // sensor connected as a peripheral, valid in CENTRAL_ROLE
+    HELLO_CLIENT_RELAY_QUEUE relay_queue;   // data from the sensor waiting to be sent to the central
+    UINT16                   att_mtu;       // ATT MTU used on the link
+} HELLO_CLIENT_LINK;
+
+// upstream central connection
+typedef struct
+{
+    UINT8    con_handle;                // handle of the central connection, 0 if not connected
+    UINT8    cm_index;                  // connection mux index of the central connection
+    UINT8    host_index;                // entry of the central in the host_list
+    BOOL     indication_outstanding;    // indication sent to the central is not confirmed yet
+    UINT8    conn_params;               // traffic level of the connection parameters requested from the central
+    UINT32   conn_params_time;          // app timer count when connection parameters were requested
+    HOSTINFO hostinfo;                  // client configuration of the central
+} HELLO_CLIENT_CENTRAL;
+
+#ifdef HELLO_CLIENT_PROFILE
+// cycles spent in a callback
+typedef struct
+{
+    UINT32  count;                      // number of calls, halved with the sum on overflow
+    UINT32  sum;
+    UINT32  min;
+    UINT32  max;
+} HELLO_CLIENT_PROFILE_ENTRY;
+#endif
+
+#ifdef HELLO_CLIENT_BENCH
+// counters of the running benchmark step
+typedef struct
+{
+    UINT8   state;                      // one of the HELLO_CLIENT_BENCH_ states
+    UINT8   rate_index;                 // rate of the step in hello_client_bench_rate
+    UINT8   num_sensors;                // sensors driven in the step
+    UINT32  step_start;                 // app timer count when the step started
+    UINT16  seq_next[HELLO_CLIENT_MAX_PERIPHERALS]; // sequence number expected from each link
+    UINT8   seq_valid;                  // bit of each link which sequence number is known
+    UINT32  frames;                     // frames sent to the central in the step
+    UINT32  bytes;                      // bytes sent to the central in the step
+    UINT32  seq_drops;                  // frames lost between the sensors and the client
+    UINT32  overflow_drops;             // relay_overflow_drops at the start of the step
+    UINT32  dwell[HELLO_CLIENT_BENCH_BUCKETS];
+    BOOL    link_down;                  // sensor link went down and did not come up yet
+    UINT32  link_down_time;             // fine timer count when the sensor link went down
+    UINT8   reconnects;                 // sensor links which came up again in the step
+    UINT32  reconnect_max;              // longest time from a sensor link down to the next up, ms
+} HELLO_CLIENT_BENCH_STATE;
+#endif
+
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+// trace saved to be printed later
+typedef struct
+{
+    const char *fmt;
+    UINT32      a;
+    UINT32      b;
+} HELLO_CLIENT_TRACE_ENTRY;
+#endif
+
+// sensor found during the scan waiting for connection
+typedef struct
+{
+    BD_ADDR bdaddr;
+    UINT8   addr_type;
+    INT8    rssi;
+} HELLO_CLIENT_CANDIDATE;
+
+// advertiser recently seen without the Hello Sensor service
+typedef struct
+{
+    BD_ADDR bdaddr;
+    UINT8   misses;                     // number of advertisements without the service
+    BOOL    adv_missed;                 // last advertisement did not have the service, scan response may have it
+} HELLO_CLIENT_ADV_CACHE_ENTRY;
+
 /******************************************************
  *               Function Prototypes
  ******************************************************/
@@ -124,6 +597,7 @@ static void   hello_client_timeout(UINT32 count);
 static void   hello_client_fine_timeout(UINT32 finecount);
 static void   hello_client_app_timer(UINT32 count);
 static void   hello_client_app_fine_timer(UINT32 finecount);
+static void   hello_client_rssi_update(void);
 static void   hello_client_advertisement_report(HCIULP_ADV_PACKET_REPORT_WDATA *evt);
 static void   hello_client_connection_up(void);
 static void   hello_client_connection_down(void);
@@ -133,9 +607,85 @@ static void   hello_client_notification_handler(int len, int attr_len, UINT8 *da
 static void   hello_client_indication_handler(int len, int attr_len, UINT8 *data);
 static void   hello_client_process_rsp(int len, int attr_len, UINT8 *data);
 static void   hello_client_process_write_rsp();
+static BOOL   hello_client_relay_to_central(UINT8 *data, int len);
+static BOOL   hello_client_relay_can_send(void);
+static BOOL   hello_client_relay_subscribed(void);
+static void   hello_client_relay_drain(void);
+static void   hello_client_relay_queue_reset(int cm_index);
+static void   hello_client_relay_release_confirmations(void);
+static HELLO_CLIENT_REASM_BUF *hello_client_reasm_find(int cm_index);
+static HELLO_CLIENT_REASM_BUF *hello_client_reasm_alloc(void);
+static void   hello_client_reasm_receive(int cm_index, UINT8 *data, int len);
+static void   hello_client_reasm_drop(HELLO_CLIENT_REASM_BUF *p);
+static void   hello_client_reasm_drain(void);
+static void   hello_client_reasm_timeout(void);
+static void   hello_client_indication_cfm(void);
+static void   hello_client_peer_cache_load(void);
+static int    hello_client_peer_cache_find(UINT8 *bdaddr);
+static int    hello_client_link_find(UINT16 con_handle);
+static BOOL   hello_client_rotate_holdoff(int cache_index);
+static void   hello_client_cmd_enqueue(UINT8 target, UINT8 *data, int len);
+static void   hello_client_cmd_drain(void);
+static void   hello_client_set_priority(UINT8 cm_index, UINT8 priority);
+static void   hello_client_hostinfo_changed(HELLO_CLIENT_CENTRAL *p_central);
+static void   hello_client_hostinfo_flush(void);
+static void   hello_client_hostinfo_restore(HELLO_CLIENT_CENTRAL *p_central, UINT8 *bdaddr);
+static void   hello_client_central_secured(void);
+static HELLO_CLIENT_CENTRAL *hello_client_central_find(UINT16 con_handle);
+static BOOL   hello_client_host_in_use(int index);
+static BOOL   hello_client_central_wanted(void);
+static void   hello_client_cmd_cancel(int cm_index);
+static BOOL   hello_client_rotate_possible(void);
+static void   hello_client_rotate_to(UINT8 *bdaddr);
+static BOOL   hello_client_reconnect_start(void);
+static void   hello_client_reconnect_stop(void);
+static BOOL   hello_client_peer_is_connected(UINT8 *bdaddr);
+static void   hello_client_peer_ready(int cm_index);
+static void   hello_client_peer_secured(void);
+static void   hello_client_peer_discovery_timeout(int cm_index);
+static void   hello_client_stats_update(void);
+static void   hello_client_traffic_update(HELLO_CLIENT_LINK_STATS *p_stats);
+static void   hello_client_central_conn_params_update(HELLO_CLIENT_CENTRAL *p_central);
+static BOOL   hello_client_connect_next_candidate(void);
+static void   hello_client_state_event(UINT8 event);
+static void   hello_client_config_load(void);
+static BOOL   hello_client_config_valid(HELLO_CLIENT_CONFIG_RECORD *p);
+static void   hello_client_config_apply(void);
+static void   hello_client_config_update(void);
+static int    hello_client_free_links(void);
+static void   hello_client_scan_reset_backoff(void);
+static void   hello_client_scan_restart(UINT8 mode);
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+static void   hello_client_trace_defer(const char *fmt, UINT32 a, UINT32 b);
+static void   hello_client_trace_flush(void);
+#endif
 static int    hello_client_write_handler(LEGATTDB_ENTRY_HDR *p);
 static UINT32 hello_client_interrupt_handler(UINT32 value);
 static void   hello_client_timer_callback(UINT32 arg);
+static void   hello_client_timers_start(void);
+static void   hello_client_timers_stop(void);
+static BOOL   hello_client_is_idle(void);
+static UINT32 hello_client_lpm_query(LowPowerModePollType type, UINT32 context);
+#ifdef HELLO_CLIENT_PROFILE
+static void   hello_client_profile_update(void);
+static void   hello_client_profile_dump(void);
+static void   hello_client_connection_up_profiled(void);
+static void   hello_client_connection_down_profiled(void);
+static void   hello_client_notification_handler_profiled(int len, int attr_len, UINT8 *data);
+static void   hello_client_indication_handler_profiled(int len, int attr_len, UINT8 *data);
+static void   hello_client_advertisement_report_profiled(HCIULP_ADV_PACKET_REPORT_WDATA *evt);
+static int    hello_client_write_handler_profiled(LEGATTDB_ENTRY_HDR *p);
+static void   hello_client_app_timer_profiled(UINT32 arg);
+static void   hello_client_app_fine_timer_profiled(UINT32 arg);
+static void   hello_client_timer_callback_profiled(UINT32 arg);
+#endif
+#ifdef HELLO_CLIENT_BENCH
+static void   hello_client_bench_timeout(UINT32 count);
+static void   hello_client_bench_receive(int cm_index, UINT8 *data, int len);
+static void   hello_client_bench_relayed(UINT8 *data, int len, UINT32 arrival);
+static void   hello_client_bench_link_down(int cm_index);
+static void   hello_client_bench_link_up(void);
+#endif
 
 /******************************************************
  *               Variables Definitions
@@ -195,7 +745,7 @@ const UINT8 hello_client_gatt_database[]=
     // (see handle 2b below).  Note that UUID of the vendor specific characteristic is
     // 16 bytes, unlike standard Bluetooth UUIDs which are 2 bytes.  _UUID128 version
     // of the macro should be used.
-    CHARACTERISTIC_UUID128_WRITABLE (0x0029, HANDLE_HELLO_CLIENT_DATA_VALUE, UUID_HELLO_CLIENT_DATA,
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_HELLO_CLIENT_DATA, HANDLE_HELLO_CLIENT_DATA_VALUE, UUID_HELLO_CLIENT_DATA,
             LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE | LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE | LEGATTDB_CHAR_PROP_NOTIFY | LEGATTDB_CHAR_PROP_INDICATE | LEGATTDB_CHAR_PROP_INDICATE,
             LEGATTDB_PERM_READABLE | LEGATTDB_PERM_AUTH_READABLE | LEGATTDB_PERM_WRITE_CMD  | LEGATTDB_PERM_WRITE_REQ | LEGATTDB_PERM_AUTH_WRITABLE | LEGATTDB_PERM_VARIABLE_LENGTH, 20),
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -211,6 +761,24 @@ const UINT8 hello_client_gatt_database[]=
                                      LEGATTDB_PERM_READABLE | LEGATTDB_PERM_AUTH_READABLE | LEGATTDB_PERM_WRITE_REQ | LEGATTDB_PERM_AUTH_WRITABLE, 2),
         0x00,0x00,
 
+    // Handle 0x2c: characteristic Hello Client Statistics, handle 0x2d characteristic value.
+    // Peer writes connection mux index (1 byte) to select the connection, and reads
+    // counters of that connection.  The value is refreshed every second.
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_HELLO_CLIENT_STATS, HANDLE_HELLO_CLIENT_STATS_VALUE, UUID_HELLO_CLIENT_STATS,
+            LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE,
+            LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ | LEGATTDB_PERM_VARIABLE_LENGTH, 20),
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+
+    // Handle 0x2e: characteristic Hello Client Configuration, handle 0x2f characteristic value.
+    // Scan, connection and aggregation parameters as HELLO_CLIENT_CONFIG_RECORD.  Value
+    // written by the paired peer is applied right away and saved in the NVRAM.
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_HELLO_CLIENT_CONFIG, HANDLE_HELLO_CLIENT_CONFIG_VALUE, UUID_HELLO_CLIENT_CONFIG,
+            LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE,
+            LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ | LEGATTDB_PERM_AUTH_WRITABLE | LEGATTDB_PERM_VARIABLE_LENGTH, 20),
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+
     // Handle 0x4d: Device Info service
     // Device Information service helps peer to identify manufacture or vendor
     // of the device.  It is required for some types of the devices (for example HID,
@@ -243,7 +811,7 @@ const UINT8 hello_client_gatt_database[]=
 
 const BLE_PROFILE_CFG hello_client_cfg =
 {
-    /*.fine_timer_interval            =*/ 1000, // ms
+    /*.fine_timer_interval            =*/ HELLO_CLIENT_FINE_TIMER_INTERVAL, // ms
     /*.default_adv                    =*/ HIGH_UNDIRECTED_DISCOVERABLE,
     /*.button_adv_toggle              =*/ 0,    // pairing button make adv toggle (if 1) or always on (if 0)
     /*.high_undirect_adv_interval     =*/ 32,   // slots
@@ -291,6 +859,15 @@ const BLE_PROFILE_CFG hello_client_cfg =
 #endif
 };
 
+// Connection parameters requested from the central for each traffic level.  Short interval
+// for bursts, and slave latency when there is nothing to send.
+const HELLO_CLIENT_CONN_PARAMS hello_client_central_conn_params[] =
+{
+    /* HELLO_CLIENT_TRAFFIC_IDLE   */ { 100, 116, 4, 500 },
+    /* HELLO_CLIENT_TRAFFIC_NORMAL */ { 100, 116, 0, 500 },
+    /* HELLO_CLIENT_TRAFFIC_BURST  */ { 16,  24,  0, 500 },
+};
+
 // Following structure defines UART configuration
 const BLE_PROFILE_PUART_CFG hello_client_puart_cfg =
 {
@@ -328,31 +905,111 @@ typedef struct t_APP_STATE
     UINT32  app_timer_count;
     UINT32  app_fine_timer_count;
 
-    UINT8   handle_to_central;           // handle of the central connection
+    UINT8   num_centrals;               // number of connected centrals
     UINT8   num_peripherals;            // number of active peripherals
 
-    UINT16  data_handle;                // handle of the sensor's measurement characteristic
-    UINT16  config_handle;              // handle of the sensor's configuration characteristic
-    UINT16  data_descriptor_handle;     // handle of the measurements client configuration descriptor
+    // context of each connection and connection mux index of each connection handle
+    HELLO_CLIENT_LINK link[HELLO_CLIENT_MAX_PERIPHERALS];
+    UINT8   link_index[HELLO_CLIENT_CONN_HANDLE_RANGE];
+
+    // roster of the sensors known from the previous connections with their handles
+    HELLO_CLIENT_PEER_CACHE peer_cache[HELLO_CLIENT_PEER_CACHE_SIZE];
+    UINT8   peer_cache_next;            // cache entry to be replaced next
+    UINT8   peer_cache_traffic[HELLO_CLIENT_PEER_CACHE_SIZE]; // traffic level of the sensor at the end of the last connection
+    UINT32  peer_cache_rotate_time[HELLO_CLIENT_PEER_CACHE_SIZE]; // app timer count when sensor gave its link to another sensor
+
+    HELLO_CLIENT_CENTRAL central[HELLO_CLIENT_MAX_CENTRALS];
+    UINT8   stats_index;                // connection which counters are in the statistics characteristic
+
+    // host info of all known centrals as saved in the NVRAM
+    HOSTINFO host_list[HELLO_CLIENT_MAX_HOSTS];
+    UINT8   host_next;                  // host_list entry to be replaced next
+    BOOL    hostinfo_dirty;             // hostinfo changed and is not written to the NVRAM yet
+    UINT32  hostinfo_dirty_time;        // app timer count of the last change of the hostinfo
+
+    // data waiting to be sent to the central, one queue in each link
+    UINT8   relay_rr;                   // queue to be checked first on the next send
+    UINT8   relay_rr_alarm;             // alarm queue to be checked first on the next send
+    BOOL    relay_rr_credited;          // queue at relay_rr got its quantum in this round
+    UINT8   relay_queued;               // number of entries in all queues
+    UINT8   relay_high_water;           // max number of entries ever queued
+    UINT16  relay_queued_bytes;         // size of all queued entries as aggregated records
+    UINT16  aggr_flush_threshold;       // send aggregated PDU when it has this many bytes
+    UINT8   aggr_flush_ticks;           // send aggregated PDU not later than in this number of fine timer ticks
+    UINT32  relay_overflow_drops;       // number of entries dropped because the queue was full
+    UINT32  relay_truncated;            // number of values cut to fit the central link MTU
+    UINT32  relay_link_down_drops;      // number of entries dropped because the sensor link went down
+    UINT8   confirms_held;              // number of sensors waiting for the indication confirmation
+
+    // sensor records larger than one notification
+    HELLO_CLIENT_REASM_BUF reasm[HELLO_CLIENT_REASM_POOL_SIZE];
+    UINT8   reasm_sending;              // number of complete records waiting to be sent
+    UINT8   reasm_current;              // record which segments are being sent
+    UINT16  reasm_drops;                // records dropped because a segment was lost or no buffer was free
+
+    // commands from the central waiting to be written to the sensors
+    HELLO_CLIENT_CMD_ENTRY cmd_queue[HELLO_CLIENT_CMD_QUEUE_DEPTH];
+    UINT8   cmd_head;                   // index of the oldest command
+    UINT8   cmd_count;                  // number of commands in the queue
+    UINT16  cmd_drops;                  // commands dropped because the queue was full or the sensor did not respond
+    UINT32  aggr_deadline;              // fine timer count when aggregated data has to be sent
+
+    HELLO_CLIENT_CANDIDATE candidate[HELLO_CLIENT_MAX_PERIPHERALS];
+    UINT8   num_candidates;             // number of sensors in the candidate list
+    BOOL    collecting_candidates;      // candidate collection window is open
+    UINT32  candidate_deadline;         // fine timer count when collection window ends
+    UINT16  low_scan_interval;          // configured low scan interval, restored when sensor shows up
+    BOOL    reconnecting;               // connection is created to the sensors in the accept list
+    UINT32  reconnect_fail_time;        // app timer count when the accept list connection timed out, 0 if never
+    BOOL    timers_stopped;             // application timers are stopped while idle
+    UINT8   state;                      // one of the HELLO_CLIENT_STATE_ states
+
+    // runtime configuration, and the configuration of the build restored on request
+    HELLO_CLIENT_CONFIG_RECORD config;
+    HELLO_CLIENT_CONFIG_RECORD config_default;
+
+    HELLO_CLIENT_ADV_CACHE_ENTRY adv_cache[HELLO_CLIENT_ADV_CACHE_SIZE];
+    UINT8   adv_cache_count;            // number of valid entries in the adv_cache
+    UINT8   adv_cache_next;             // entry to be replaced next
+
+#ifdef HELLO_CLIENT_PROFILE
+    HELLO_CLIENT_PROFILE_ENTRY profile[HELLO_CLIENT_PROFILE_NUM];
+#endif
 
-    // space to save device info and smp_info to handle multiple connections
-    EMCONINFO_DEVINFO dev_info[HELLO_CLIENT_MAX_PERIPHERALS];
-    LESMP_INFO        smp_info[HELLO_CLIENT_MAX_PERIPHERALS];
+#ifdef HELLO_CLIENT_BENCH
+    HELLO_CLIENT_BENCH_STATE bench;
+#endif
 
-    HOSTINFO hostinfo;                  // NVRAM save area
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+    HELLO_CLIENT_TRACE_ENTRY trace_buf[HELLO_CLIENT_TRACE_BUF_SIZE];
+    UINT8   trace_count;                // number of traces in the trace_buf
+    UINT16  trace_drops;                // number of traces lost because trace_buf was full
+#endif
 } tAPP_STATE;
 
 tAPP_STATE hello_client;
 
 BD_ADDR bd_addr_any                             = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+BD_ADDR bd_addr_none                            = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 BD_ADDR hello_client_target_addr                = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 UINT8   hello_client_target_addr_type           = 0;
 
+#ifdef HELLO_CLIENT_BENCH
+// notifications per second of each sensor in the benchmark steps
+const UINT8 hello_client_bench_rate[] = {1, 2, 5, 10, 20, 50};
+#endif
+
 
 // Following variables are in ROM
 extern BLE_CEN_CFG     blecen_cen_cfg;
 extern BLEAPP_TIMER_CB blecen_usertimerCb;
 
+// RSSI of the last packet received on the connection.  The call is in the ROM of
+// the 20736 but is not declared in the SDK headers, the prototype is assumed
+// from its name and has to be checked against the ROM symbol table of the SDK
+// before the weak link drop is relied on.
+extern INT8 lm_getRSSI(UINT8 con_handle);
+
 /******************************************************
  *               Function Definitions
  ******************************************************/
@@ -387,22 +1044,51 @@ void hello_client_l2cap_smp_data_handler(UINT8 *l2capHdr)
 // Create hello sensor
 void hello_client_create(void)
 {
+    int i;
+
     ble_trace0("hello_client_create()\n");
     ble_trace0(bleprofile_p_cfg->ver);
 
+#if HELLO_CLIENT_TRACE_LEVEL == 2
     extern UINT32 blecm_configFlag ;
     blecm_configFlag |= BLECM_DBGUART_LOG | BLECM_DBGUART_LOG_L2CAP | BLECM_DBGUART_LOG_SMP;
 
     // dump the database to debug uart.
     legattdb_dumpDb();
+#endif
 
     memset (&hello_client, 0, sizeof (hello_client));
 
+#if defined(HELLO_CLIENT_PROFILE) || defined(HELLO_CLIENT_BENCH)
+    // enable the cycle counter
+    HELLO_CLIENT_DEMCR     |= 0x01000000;
+    HELLO_CLIENT_DWT_CYCCNT = 0;
+    HELLO_CLIENT_DWT_CTRL  |= 0x00000001;
+#endif
+
     hello_client.app_config = 0
                             | CONNECT_HELLO_SENSOR
                             | SMP_PAIRING
+                            | AUTO_RECONNECT
+                            // | RELAY_AGGREGATE
+                            // | RELAY_SEGMENTED
                             ;
 
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        hello_client.link[i].stats.role = NO_ROLE;
+    }
+    memset(hello_client.link_index, HELLO_CLIENT_NO_LINK, sizeof(hello_client.link_index));
+    hello_client.reasm_current = HELLO_CLIENT_REASM_NONE;
+
+    // host info of the centrals saved before the reset
+    if (bleprofile_ReadNVRAM(NVRAM_ID_HOST_LIST, sizeof(hello_client.host_list), (UINT8 *)hello_client.host_list) != sizeof(hello_client.host_list))
+    {
+        memset(hello_client.host_list, 0, sizeof(hello_client.host_list));
+    }
+
+    hello_client_peer_cache_load();
+
     // Blecen default parameters.  Change if appropriate
     //blecen_cen_cfg.scan_type                = HCIULP_ACTIVE_SCAN;
     //blecen_cen_cfg.scan_adr_type            = HCIULP_PUBLIC_ADDRESS;
@@ -429,10 +1115,15 @@ void hello_client_create(void)
 
     //change parameter
     blecen_cen_cfg.filter_duplicates        = HCIULP_SCAN_DUPLICATE_FILTER_OFF;
-    blecen_usertimerCb                      = hello_client_timer_callback;
+    blecen_usertimerCb                      = HELLO_CLIENT_PROFILED(hello_client_timer_callback);
     blecen_cen_cfg.high_supervision_timeout = 400;      // N * 10ms
     blecen_cen_cfg.low_supervision_timeout  = 700;      // N * 10ms
 
+    hello_client.low_scan_interval          = blecen_cen_cfg.low_scan_interval;
+
+    // configuration tuned over the air replaces the one of the build
+    hello_client_config_load();
+
     //enable multi connection
     blecm_ConMuxInit(HELLO_CLIENT_MAX_PERIPHERALS);
     blecm_enableConMux();
@@ -440,15 +1131,15 @@ void hello_client_create(void)
 
     blecen_Create();
 
-    // we will not do scan until user pushes the button for 5 seconds
+    // scan is started by the state machine once the application is ready
     blecen_Scan(NO_SCAN);
 
     bleprofile_Init(bleprofile_p_cfg);
     bleprofile_GPIOInit(bleprofile_gpio_p_cfg);
 
     // register connection up and connection down handler.
-    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_UP, hello_client_connection_up);
-    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_DOWN, hello_client_connection_down);
+    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_UP, HELLO_CLIENT_PROFILED(hello_client_connection_up));
+    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_DOWN, HELLO_CLIENT_PROFILED(hello_client_connection_down));
 
     // register the handler for the CID.
     lel2cap_regConnLessHandler(6, (LEL2CAP_L2CAPHANDLER)hello_client_l2cap_smp_data_handler);
@@ -475,9 +1166,9 @@ void hello_client_create(void)
              | LESMP_KEY_DISTRIBUTION_SIGN_KEY
     );
     // register to process peripheral advertisements, notifications and indications
-    blecm_RegleAdvReportCb((BLECM_FUNC_WITH_PARAM) hello_client_advertisement_report);
-    leatt_regNotificationCb((LEATT_TRIPLE_PARAM_CB) hello_client_notification_handler);
-    leatt_regIndicationCb((LEATT_TRIPLE_PARAM_CB) hello_client_indication_handler);
+    blecm_RegleAdvReportCb((BLECM_FUNC_WITH_PARAM) HELLO_CLIENT_PROFILED(hello_client_advertisement_report));
+    leatt_regNotificationCb((LEATT_TRIPLE_PARAM_CB) HELLO_CLIENT_PROFILED(hello_client_notification_handler));
+    leatt_regIndicationCb((LEATT_TRIPLE_PARAM_CB) HELLO_CLIENT_PROFILED(hello_client_indication_handler));
 
     // GATT client callbacks
     leatt_regReadRspCb((LEATT_TRIPLE_PARAM_CB) hello_client_process_rsp);
@@ -486,40 +1177,62 @@ void hello_client_create(void)
     leatt_regWriteRspCb((LEATT_NO_PARAM_CB) hello_client_process_write_rsp);
 
     // register to process client writes
-    legattdb_regWriteHandleCb((LEGATTDB_WRITE_CB)hello_client_write_handler);
+    legattdb_regWriteHandleCb((LEGATTDB_WRITE_CB)HELLO_CLIENT_PROFILED(hello_client_write_handler));
 
     // process button
     bleprofile_regIntCb(hello_client_interrupt_handler);
 
-    // need to do adverts to enable peripheral connections
-    bleprofile_Discoverable(HIGH_UNDIRECTED_DISCOVERABLE, NULL);
+    // reconnect to the sensors known before the reset, or look for the new ones
+    hello_client_state_event(HELLO_CLIENT_EVENT_START);
 
     // change timer callback function.  because we are running ROM app, need to
     // stop timer first.
     bleprofile_KillTimer();
-    bleprofile_regTimerCb(hello_client_app_fine_timer, hello_client_app_timer);
+    bleprofile_regTimerCb(HELLO_CLIENT_PROFILED(hello_client_app_fine_timer), HELLO_CLIENT_PROFILED(hello_client_app_timer));
     bleprofile_StartTimer();
+
+    // tell firmware when device can sleep
+    devlpm_registerForLowPowerQueries(hello_client_lpm_query, 0);
+}
+
+//
+// Return connection mux index of the link with the connection handle, or -1 if connection
+// handle is not known.  Controller assigns handles from RMULP_CONN_HANDLE_START, so the
+// link is found without searching the connection mux.
+//
+int hello_client_link_find(UINT16 con_handle)
+{
+    UINT16 slot = con_handle - RMULP_CONN_HANDLE_START;
+
+    if ((slot >= HELLO_CLIENT_CONN_HANDLE_RANGE) || (hello_client.link_index[slot] == HELLO_CLIENT_NO_LINK))
+    {
+        return -1;
+    }
+    return hello_client.link_index[slot];
 }
 
 // This function will be called on every connection establishmen
 void hello_client_connection_up(void)
 {
     UINT8 *p_remote_addr     = (UINT8 *)emconninfo_getPeerAddr();
-    UINT8 *p_remote_pub_addr = (UINT8 *)emconninfo_getPeerPubAddr();
     UINT16 con_handle        = emconinfo_getConnHandle();
-    int cm_index = blecm_FindConMux(con_handle);
+    int cm_index = hello_client_link_find(con_handle);
+
+    // central may connect while timers are stopped
+    hello_client_timers_start();
 
     //delete index first
     if (cm_index >= 0)
     {
         blecm_DelConMux(cm_index);
+        hello_client.link_index[con_handle - RMULP_CONN_HANDLE_START] = HELLO_CLIENT_NO_LINK;
     }
 
     //find free index
     cm_index = blecm_FindFreeConMux();
 
     //set information
-    if (cm_index < 0)
+    if ((cm_index < 0) || ((UINT16)(con_handle - RMULP_CONN_HANDLE_START) >= HELLO_CLIENT_CONN_HANDLE_RANGE))
     {
         ble_trace0("---!!!hello_client_connection_up failed to get mux\n");
         blecm_disconnect(BT_ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
@@ -527,29 +1240,68 @@ void hello_client_connection_up(void)
     }
 
     // copy dev_pinfo
-    memcpy((UINT8 *)&hello_client.dev_info[cm_index], (UINT8 *)emconinfo_getPtr(), sizeof(EMCONINFO_DEVINFO));
+    memcpy((UINT8 *)&hello_client.link[cm_index].dev_info, (UINT8 *)emconinfo_getPtr(), sizeof(EMCONINFO_DEVINFO));
 
     // copy smp_pinfo
-    memcpy((UINT8 *)&hello_client.smp_info[cm_index], (UINT8 *)lesmp_getPtr(), sizeof(LESMP_INFO));
+    memcpy((UINT8 *)&hello_client.link[cm_index].smp_info, (UINT8 *)lesmp_getPtr(), sizeof(LESMP_INFO));
 
     blecm_AddConMux(cm_index, con_handle, sizeof (hello_client_gatt_database), (void *)hello_client_gatt_database,
-        &hello_client.dev_info[cm_index], &hello_client.smp_info[cm_index]);
+        &hello_client.link[cm_index].dev_info, &hello_client.link[cm_index].smp_info);
+
+    hello_client.link_index[con_handle - RMULP_CONN_HANDLE_START] = cm_index;
+
+    // MTU is not exchanged, ROM ATT uses the default on all links
+    hello_client.link[cm_index].att_mtu = HELLO_CLIENT_ATT_DEFAULT_MTU;
+
+    memset(&hello_client.link[cm_index].stats, 0, sizeof(HELLO_CLIENT_LINK_STATS));
+    hello_client.link[cm_index].stats.role         = hello_client.link[cm_index].dev_info.role;
+    hello_client.link[cm_index].stats.conn_up_time = hello_client.app_fine_timer_count;
+    hello_client.link[cm_index].stats.traffic      = HELLO_CLIENT_TRAFFIC_NORMAL;
 
     // if we connected as a central configure peripheral to enable notifications
-    if (hello_client.dev_info[cm_index].role == CENTRAL_ROLE)
+    if (hello_client.link[cm_index].dev_info.role == CENTRAL_ROLE)
     {
-        hello_client.smp_info[cm_index].smpRole = LESMP_ROLE_INITIATOR;
+        HELLO_CLIENT_PEER *p_peer = &hello_client.link[cm_index].peer;
+        int cache_index           = hello_client_peer_cache_find(p_remote_addr);
+
+        if (hello_client.reconnecting)
+        {
+            hello_client_reconnect_stop();
+        }
+#ifdef HELLO_CLIENT_BENCH
+        hello_client_bench_link_up();
+#endif
+
+        hello_client.link[cm_index].smp_info.smpRole = LESMP_ROLE_INITIATOR;
+
+        memset(p_peer, 0, sizeof(HELLO_CLIENT_PEER));
+        memcpy(p_peer->bdaddr, p_remote_addr, sizeof(BD_ADDR));
+        p_peer->con_handle = con_handle;
+        p_peer->addr_type  = hello_client_target_addr_type;
+        p_peer->priority   = HELLO_CLIENT_PRIORITY_NORMAL;
+
+        // handles known from the previous connection do not need to be discovered
+        if (cache_index >= 0)
+        {
+            p_peer->service_start_handle   = hello_client.peer_cache[cache_index].service_start_handle;
+            p_peer->service_end_handle     = hello_client.peer_cache[cache_index].service_end_handle;
+            p_peer->data_handle            = hello_client.peer_cache[cache_index].data_handle;
+            p_peer->config_handle          = hello_client.peer_cache[cache_index].config_handle;
+            p_peer->data_descriptor_handle = hello_client.peer_cache[cache_index].data_descriptor_handle;
+            p_peer->config_properties      = hello_client.peer_cache[cache_index].config_properties;
+            p_peer->addr_type              = hello_client.peer_cache[cache_index].addr_type;
+            p_peer->priority               = hello_client.peer_cache[cache_index].priority;
+        }
 
         if (bleprofile_p_cfg->encr_required == 0)
         {
-            UINT16 u16 = 1;
-            bleprofile_sendWriteReq(HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR, (UINT8 *)&u16, 2);
+            hello_client_peer_ready(cm_index);
         }
         else
         {
             // following call will start pairing if devices are not paired, or will request
             // encryption if pairing has been established before
-            lesmp_setPtr(&hello_client.smp_info[cm_index]);
+            lesmp_setPtr(&hello_client.link[cm_index].smp_info);
 
             lesmp_startPairing(NULL);
             ble_trace0("starting security\n");
@@ -560,22 +1312,50 @@ void hello_client_connection_up(void)
     }
     else
     {
-        hello_client.smp_info[cm_index].smpRole = LESMP_ROLE_RESPONDERS;
+        HELLO_CLIENT_CENTRAL *p_central = hello_client_central_find(0);
+
+        hello_client.link[cm_index].smp_info.smpRole = LESMP_ROLE_RESPONDERS;
 
-        hello_client.handle_to_central = con_handle;
+        if (p_central == NULL)
+        {
+            ble_trace0("no room for another central\n");
+            blecm_disconnect(BT_ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
+            return;
+        }
+
+        // client configuration is restored when the link is encrypted
+        p_central->con_handle = con_handle;
+        p_central->cm_index   = cm_index;
+        p_central->host_index = HELLO_CLIENT_NO_HOST;
+        hello_client.num_centrals++;
 
         // ask central to set preferred connection parameters
-        lel2cap_sendConnParamUpdateReq(100, 116, 0, 500);
+        p_central->conn_params      = HELLO_CLIENT_TRAFFIC_NORMAL;
+        p_central->conn_params_time = hello_client.app_timer_count;
+        lel2cap_sendConnParamUpdateReq(hello_client_central_conn_params[HELLO_CLIENT_TRAFFIC_NORMAL].min_interval,
+                                       hello_client_central_conn_params[HELLO_CLIENT_TRAFFIC_NORMAL].max_interval,
+                                       hello_client_central_conn_params[HELLO_CLIENT_TRAFFIC_NORMAL].latency,
+                                       hello_client_central_conn_params[HELLO_CLIENT_TRAFFIC_NORMAL].timeout);
     }
 
-    ble_trace4("hello_client_connection_up handle:%x peripheral:%d num:%d to_central:%d\n", con_handle,
-    hello_client.dev_info[cm_index].role, hello_client.num_peripherals, hello_client.handle_to_central);
+    ble_trace4("hello_client_connection_up handle:%x peripheral:%d num:%d centrals:%d\n", con_handle,
+    hello_client.link[cm_index].dev_info.role, hello_client.num_peripherals, hello_client.num_centrals);
 
-    // if we are not connected to all peripherals restart the scan
-    if (hello_client.num_peripherals < HELLO_CLIENT_MAX_PERIPHERALS)
+    // continue with the sensors found in the same scan, or with other sensors of the roster
+    if (hello_client.link[cm_index].dev_info.role == CENTRAL_ROLE)
+    {
+        hello_client_state_event(HELLO_CLIENT_EVENT_LINK_UP);
+    }
+    // central took a link, no need to scan when all links are used
+    else if (hello_client_free_links() <= 0)
+    {
+        hello_client.num_candidates = 0;
+        hello_client_scan_restart(NO_SCAN);
+    }
+    else if (hello_client.num_peripherals < HELLO_CLIENT_MAX_PERIPHERALS)
     {
-        // if we are not connected to the central enable advertisements
-        if (!hello_client.handle_to_central)
+        // if another central can connect enable advertisements
+        if (hello_client_central_wanted())
         {
             ble_trace0("Adv during conn enable\n");
             blecm_setAdvDuringConnEnable(TRUE);
@@ -593,7 +1373,8 @@ void hello_client_connection_up(void)
 void hello_client_connection_down(void)
 {
     UINT16 con_handle = emconinfo_getConnHandle();
-    int cm_index = blecm_FindConMux(con_handle);
+    int cm_index = hello_client_link_find(con_handle);
+    UINT8 role;
 
     if (cm_index < 0)
     {
@@ -607,291 +1388,3133 @@ void hello_client_connection_down(void)
         ble_trace0("Pairing Key removed\n");
     }
 
-    ble_trace3("Conn Down handle:%x Peripheral:%d Disc_Reason: %02x\n", con_handle, hello_client.dev_info[cm_index].role, emconinfo_getDiscReason());
+    role = hello_client.link[cm_index].dev_info.role;
+    ble_trace3("Conn Down handle:%x Peripheral:%d Disc_Reason: %02x\n", con_handle, role, emconinfo_getDiscReason());
 
-    if (hello_client.dev_info[cm_index].role == PERIPHERAL_ROLE)
+    if (role == PERIPHERAL_ROLE)
     {
-        hello_client.handle_to_central = 0;
+        HELLO_CLIENT_CENTRAL *p_central = hello_client_central_find(con_handle);
+
+        if (p_central != NULL)
+        {
+            memset(p_central, 0, sizeof(HELLO_CLIENT_CENTRAL));
+            hello_client.num_centrals--;
+        }
+
+        // save changes done by the central while link was up
+        hello_client_hostinfo_flush();
+
+        // data which waited for this central can go to the others
+        hello_client_relay_drain();
 
         // restart scan
         blecm_setAdvDuringConnEnable (TRUE);
     }
     else
     {
+        int cache_index = hello_client_peer_cache_find(hello_client.link[cm_index].peer.bdaddr);
+        HELLO_CLIENT_REASM_BUF *p_reasm = hello_client_reasm_find(cm_index);
+
         blecli_ClientHandleReset();
         blecen_connDown();
+#ifdef HELLO_CLIENT_BENCH
+        hello_client_bench_link_down(cm_index);
+#endif
+
+        // next connection to this sensor starts with parameters for the traffic it had
+        if (cache_index >= 0)
+        {
+            hello_client.peer_cache_traffic[cache_index] = hello_client.link[cm_index].stats.traffic;
+        }
+
+        if (hello_client.link[cm_index].peer.confirm_held)
+        {
+            hello_client.confirms_held--;
+        }
+        if ((hello_client.app_config & RELAY_SEGMENTED) && (p_reasm != NULL))
+        {
+            hello_client_reasm_drop(p_reasm);
+        }
+        memset(&hello_client.link[cm_index].peer, 0, sizeof(HELLO_CLIENT_PEER));
+        hello_client_relay_queue_reset(cm_index);
+        hello_client_cmd_cancel(cm_index);
     }
 
+    // counters stay available until connection mux index is reused
+    hello_client.link[cm_index].stats.role = NO_ROLE;
+
     // delete a connection structure
-    memset (&hello_client.dev_info[cm_index], 0x00, sizeof(EMCONINFO_DEVINFO));
-    memset (&hello_client.smp_info[cm_index], 0x00, sizeof(LESMP_INFO));
+    memset (&hello_client.link[cm_index].dev_info, 0x00, sizeof(EMCONINFO_DEVINFO));
+    memset (&hello_client.link[cm_index].smp_info, 0x00, sizeof(LESMP_INFO));
 
     // count number of peripheral connections
-    hello_client.num_peripherals--;
+    if (role == CENTRAL_ROLE)
+    {
+        hello_client.num_peripherals--;
+    }
 
     //delete index
     blecm_DelConMux(cm_index);
+    hello_client.link_index[con_handle - RMULP_CONN_HANDLE_START] = HELLO_CLIENT_NO_LINK;
 
-    // if we are not connected to all peripherals restart the scan
-    if (hello_client.num_peripherals < HELLO_CLIENT_MAX_PERIPHERALS)
+    // sensor which just dropped is likely to come back soon, reconnect or scan with high duty cycle
+    if (role == CENTRAL_ROLE)
     {
-        blecen_Scan(LOW_SCAN);
+        hello_client_state_event(HELLO_CLIENT_EVENT_LINK_DOWN);
     }
-}
-
-void hello_client_timeout(UINT32 count)
-{
-    ble_trace1("hello_client_timeout:%d", count);
-}
-
-void hello_client_fine_timeout(UINT32 count)
-{
-}
-
-void hello_client_app_timer(UINT32 arg)
-{
-    switch(arg)
+    // link of the central can be used for a sensor
+    else if (blecen_GetConn() == NO_CONN)
     {
-        case BLEPROFILE_GENERIC_APP_TIMER:
-            {
-                hello_client.app_timer_count++;
-
-                hello_client_timeout(hello_client.app_timer_count);
-            }
-            break;
+        hello_client_scan_restart(LOW_SCAN);
     }
-
-    blecen_appTimerCb(arg);
 }
 
-void hello_client_app_fine_timer(UINT32 arg)
-{
-    hello_client.app_fine_timer_count++;
-    hello_client_fine_timeout(hello_client.app_fine_timer_count);
-}
-
-
 //
-// Process SMP pairing result.  If we successfully paired with the
-// central device, save its BDADDR in the NVRAM and initialize
-// associated data
+// Move the state of looking for the sensors on the event.  Next step is started
+// right away from the event, so that bring-up does not wait for the timers.
 //
-void hello_client_smp_pair_result(LESMP_PARING_RESULT  result)
+void hello_client_state_event(UINT8 event)
 {
-    blecen_smpBondResult(result);
+    ble_trace2("state:%d event:%d\n", hello_client.state, event);
 
-    if(result == LESMP_PAIRING_RESULT_BONDED)
+    if (!(hello_client.app_config & CONNECT_HELLO_SENSOR))
     {
-        // if pairing is successful register with the server to receive notification
-        UINT16 u16 = 1;
-        bleprofile_sendWriteReq(HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR, (UINT8 *)&u16, 2);
+        return;
     }
-}
 
-//
-// Process notification from the stack that encryption has been set.  If connected
-// client is registered for notification or indication, it is a good time to
-// send it out
-//
-void hello_client_encryption_changed(HCI_EVT_HDR *evt)
-{
-    UINT8 status = *((UINT8 *)(evt + 1));
-
-    ble_trace1("encryption changed: %02x\n", status);
-
-    blecen_encryptionChanged(evt);
-}
+    switch (event)
+    {
+    case HELLO_CLIENT_EVENT_START:
+    case HELLO_CLIENT_EVENT_LINK_DOWN:
+        hello_client_scan_reset_backoff();
+        if (hello_client_reconnect_start())
+        {
+            hello_client.state = HELLO_CLIENT_STATE_RECONNECT;
+            return;
+        }
+        hello_client_scan_restart(HIGH_SCAN);
+        return;
 
+    case HELLO_CLIENT_EVENT_SCAN_TIMEOUT:
+        // no new sensor during the scan, reduce duty cycle until one shows up
+        if (blecen_GetScan() == LOW_SCAN)
+        {
+            if (blecen_cen_cfg.low_scan_interval < HELLO_CLIENT_LOW_SCAN_INTERVAL_MAX / 2)
+            {
+                blecen_cen_cfg.low_scan_interval *= 2;
+            }
+            else
+            {
+                blecen_cen_cfg.low_scan_interval = HELLO_CLIENT_LOW_SCAN_INTERVAL_MAX;
+            }
+            ble_trace1("low scan interval:%d\n", blecen_cen_cfg.low_scan_interval);
+        }
 
-void hello_client_timer_callback(UINT32 arg)
-{
-    ble_trace1("hello_client_timer_callback %d\n", arg);
+        // roster sensors may be back in range, try them before scanning again
+        if (hello_client_reconnect_start())
+        {
+            hello_client.state = HELLO_CLIENT_STATE_RECONNECT;
+            return;
+        }
+        hello_client_scan_restart(LOW_SCAN);
+        return;
 
-    switch(arg)
-    {
-    case BLEAPP_APP_TIMER_SCAN:
-        blecen_Scan(LOW_SCAN);
-        break;
+    case HELLO_CLIENT_EVENT_CONN_TIMEOUT:
+        blecen_Conn(NO_CONN, NULL, 0);
 
-    case BLEAPP_APP_TIMER_CONN:
-        if ((blecen_GetConn() == HIGH_CONN) || (blecen_GetConn() == LOW_CONN))
+        // none of the roster sensors came back, look for the new ones and let the centrals connect.
+        // Scan which backed off goes on with the low duty cycle it had.
+        if (hello_client.state == HELLO_CLIENT_STATE_RECONNECT)
         {
-            blecen_Conn(NO_CONN, NULL, 0);
-            blecen_Scan(LOW_SCAN);
-            bleprofile_Discoverable(HIGH_UNDIRECTED_DISCOVERABLE, NULL);
-            ble_trace0("Connection Fail, Restart Scan and Advertisemnts\n");
+            hello_client_reconnect_stop();
+            hello_client.reconnect_fail_time = hello_client.app_timer_count;
+            hello_client_scan_restart((blecen_cen_cfg.low_scan_interval == hello_client.low_scan_interval) ? HIGH_SCAN : LOW_SCAN);
+            return;
         }
         break;
-    }
-}
-
-void hello_client_advertisement_report(HCIULP_ADV_PACKET_REPORT_WDATA *evt)
-{
-    UINT8 dataLen = (UINT8)(evt->dataLen);
 
-    // The app may crash because watch dog timer is not getting reset due to a lot of events.
-    // Reset watch dog timer every time we see an advertisement.
-    wdog_restart();
+    default:
+        break;
+    }
 
-    // make sure that advertisement data is reasonable
-    if (dataLen > HCIULP_MAX_DATA_LENGTH)
+    // try other sensors found in the same scan before scanning again
+    if (hello_client_connect_next_candidate())
     {
+        hello_client.state = HELLO_CLIENT_STATE_CONNECT;
         return;
     }
-    blecen_leAdvReportCb(evt);
 
-#ifdef HELLO_CLIENT_MIN_RSSI
-    if (evt->rssi < HELLO_CLIENT_MIN_RSSI)      // filter out adverts with low RSSI
+    // collection window is over without a sensor to connect, scan goes on
+    if (event == HELLO_CLIENT_EVENT_CANDIDATES)
     {
         return;
     }
-#endif
 
-    // parse and connection
-    if (hello_client.app_config & CONNECT_HELLO_SENSOR)
+    if ((event == HELLO_CLIENT_EVENT_LINK_UP) && hello_client_reconnect_start())
     {
-        BLE_ADV_FIELD *p_field;
-        UINT8         *data = (UINT8 *)(evt->data);
-        UINT8         *ptr = data;
-
-        UINT8 state = 0;
+        ble_trace0("reconnect other sensors\n");
+        hello_client.state = HELLO_CLIENT_STATE_RECONNECT;
+        return;
+    }
 
-        while(1)
-        {
-            UINT16 uuid;
-            p_field = (BLE_ADV_FIELD *)ptr;
+    hello_client_scan_restart((event == HELLO_CLIENT_EVENT_LINK_UP) ? HIGH_SCAN : LOW_SCAN);
+}
 
-            if ((p_field->len == 16 + 1) &&
-                (p_field->val == ADV_SERVICE_UUID128_COMP) &&
-                (memcmp (p_field->data, hello_service, 16) == 0))
-            {
-                ble_trace0("Found service, no discoverable high conn\n");
+//
+// Connect to any sensor of the roster which advertises.  Sensors are put to the
+// controller accept list and the controller creates connection to the first one
+// it hears, without the advertisement reports going through the application.
+// Returns FALSE if there is nothing to reconnect.
+//
+BOOL hello_client_reconnect_start(void)
+{
+    int num_sensors = 0;
+    int i;
 
-                bleprofile_Discoverable(NO_DISCOVERABLE, NULL);
+    if (!(hello_client.app_config & AUTO_RECONNECT) || (hello_client_free_links() <= 0) ||
+        (blecen_GetConn() != NO_CONN))
+    {
+        return FALSE;
+    }
 
-                blecen_Conn(HIGH_CONN, evt->wd_addr, evt->addressType);
-                blecen_Scan(NO_SCAN);
-                break;
-            }
+    // client does not advertise while connecting, give the centrals a chance after a failed attempt
+    if ((hello_client.reconnect_fail_time != 0) &&
+        (hello_client.app_timer_count - hello_client.reconnect_fail_time < HELLO_CLIENT_RECONNECT_HOLDOFF))
+    {
+        return FALSE;
+    }
 
-            ptr += (p_field->len + 1);
+    // accept list cannot be changed while connection is being created, fill it every time
+    blecm_clearWhiteList();
+    for (i = 0; i < HELLO_CLIENT_PEER_CACHE_SIZE; i++)
+    {
+        HELLO_CLIENT_PEER_CACHE *p_cache = &hello_client.peer_cache[i];
 
-            if (ptr >= data + dataLen)
-            {
-                break;
-            }
+        if ((p_cache->data_descriptor_handle != 0) && !hello_client_rotate_holdoff(i) &&
+            !hello_client_peer_is_connected(p_cache->bdaddr))
+        {
+            blecm_addWhiteList(p_cache->addr_type, p_cache->bdaddr);
+            num_sensors++;
         }
     }
-}
+    if (num_sensors == 0)
+    {
+        return FALSE;
+    }
 
+    ble_trace1("reconnect sensors:%d\n", num_sensors);
 
-void hello_client_process_rsp(int len, int attr_len, UINT8 *data)
-{
-    ble_trace2("Client rsp len:%d attr_len:%d\n", len, attr_len);
+    hello_client.reconnecting = TRUE;
+    blecen_cen_cfg.init_filter_policy = HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_USED;
+
+    blecen_Scan(NO_SCAN);
+    bleprofile_Discoverable(NO_DISCOVERABLE, NULL);
+    blecen_Conn(HIGH_CONN, bd_addr_any, 0);
+    return TRUE;
+}
+
+//
+// Connection to the roster sensor is up or timed out, next connection is
+// created to the specified address
+//
+void hello_client_reconnect_stop(void)
+{
+    hello_client.reconnecting = FALSE;
+    blecen_cen_cfg.init_filter_policy = HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_NOT_USED;
+}
+
+//
+// Restore configured low scan duty cycle
+//
+void hello_client_scan_reset_backoff(void)
+{
+    blecen_cen_cfg.low_scan_interval = hello_client.low_scan_interval;
+}
+
+//
+// Start scan in the specified mode if there are links for more sensors,
+// otherwise stop scanning.  Peripheral connections are enabled if another
+// central can connect.
+//
+void hello_client_scan_restart(UINT8 mode)
+{
+    if (hello_client_free_links() > 0)
+    {
+        hello_client.state = HELLO_CLIENT_STATE_SCAN;
+        blecen_Scan(mode);
+    }
+    else
+    {
+        // all links are used, keep looking for waiting sensors only if a link can be rotated
+        hello_client.state = HELLO_CLIENT_STATE_FULL;
+        blecen_Scan(hello_client_rotate_possible() ? LOW_SCAN : NO_SCAN);
+    }
+
+    if (hello_client_central_wanted())
+    {
+        bleprofile_Discoverable(HIGH_UNDIRECTED_DISCOVERABLE, NULL);
+    }
+}
+
+//
+// Classify traffic on the connection over the last second.  Link becomes busy
+// as soon as the rate reaches the burst level, and becomes idle only after a
+// number of seconds without any data.
+//
+void hello_client_traffic_update(HELLO_CLIENT_LINK_STATS *p_stats)
+{
+    UINT16 count = (p_stats->role == PERIPHERAL_ROLE) ? p_stats->notifications_out : p_stats->notifications_in;
+    UINT16 rate  = count - p_stats->notifications_last;
+
+    p_stats->notifications_last = count;
+
+    if (rate == 0)
+    {
+        if (p_stats->idle_time < 0xff)
+        {
+            p_stats->idle_time++;
+        }
+        if (p_stats->idle_time >= HELLO_CLIENT_IDLE_TIME)
+        {
+            p_stats->traffic = HELLO_CLIENT_TRAFFIC_IDLE;
+        }
+        return;
+    }
+
+    p_stats->idle_time = 0;
+
+    if (rate >= HELLO_CLIENT_BURST_RATE)
+    {
+        p_stats->traffic = HELLO_CLIENT_TRAFFIC_BURST;
+    }
+    else if ((p_stats->traffic != HELLO_CLIENT_TRAFFIC_BURST) || (rate < HELLO_CLIENT_BURST_RATE / 2))
+    {
+        p_stats->traffic = HELLO_CLIENT_TRAFFIC_NORMAL;
+    }
+}
+
+//
+// Ask central to use connection parameters which fit the current traffic.
+// Data waiting in the relay queues means that the link is too slow.
+//
+void hello_client_central_conn_params_update(HELLO_CLIENT_CENTRAL *p_central)
+{
+    HELLO_CLIENT_LINK_STATS        *p_stats = &hello_client.link[p_central->cm_index].stats;
+    const HELLO_CLIENT_CONN_PARAMS *p_params;
+    UINT8 traffic = p_stats->traffic;
+
+    if (hello_client.relay_queued > HELLO_CLIENT_RELAY_QUEUE_DEPTH)
+    {
+        traffic = HELLO_CLIENT_TRAFFIC_BURST;
+    }
+
+    if ((traffic == p_central->conn_params) ||
+        (hello_client.app_timer_count - p_central->conn_params_time < HELLO_CLIENT_CONN_UPDATE_HOLDOFF))
+    {
+        return;
+    }
+
+    p_params = &hello_client_central_conn_params[traffic];
+    ble_trace2("central conn params traffic:%d interval:%d\n", traffic, p_params->max_interval);
+
+    p_central->conn_params      = traffic;
+    p_central->conn_params_time = hello_client.app_timer_count;
+
+    blecm_SetPtrConMux(p_central->con_handle);
+    lel2cap_sendConnParamUpdateReq(p_params->min_interval, p_params->max_interval, p_params->latency, p_params->timeout);
+}
+
+void hello_client_timeout(UINT32 count)
+{
+    int i;
+
+    ble_trace4("hello_client_timeout:%d relay high water:%d drops:%d truncated:%d", count,
+               hello_client.relay_high_water, hello_client.relay_overflow_drops, hello_client.relay_truncated);
+
+    // check that discovery on the sensors is progressing
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].peer.disc_state != HELLO_CLIENT_DISC_IDLE) &&
+            (hello_client.link[i].peer.disc_state != HELLO_CLIENT_DISC_DONE) &&
+            (count - hello_client.link[i].peer.disc_start >= HELLO_CLIENT_DISCOVERY_TIMEOUT))
+        {
+            hello_client_peer_discovery_timeout(i);
+        }
+    }
+
+    // write response lost after the discovery, the command is dropped so that the next can be written
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].peer.disc_state == HELLO_CLIENT_DISC_DONE) &&
+            hello_client.link[i].peer.write_outstanding &&
+            (count - hello_client.link[i].peer.write_start >= HELLO_CLIENT_WRITE_TIMEOUT))
+        {
+            ble_trace1("write timeout handle:%x\n", hello_client.link[i].peer.con_handle);
+            hello_client.link[i].peer.write_outstanding = FALSE;
+            hello_client.cmd_drops++;
+        }
+    }
+
+    // follow the traffic on each connection
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if (hello_client.link[i].stats.role != NO_ROLE)
+        {
+            hello_client_traffic_update(&hello_client.link[i].stats);
+        }
+    }
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        if (hello_client.central[i].con_handle != 0)
+        {
+            hello_client_central_conn_params_update(&hello_client.central[i]);
+        }
+    }
+
+    // one of the links went idle, look for a sensor which is waiting for a link
+    if ((hello_client.app_config & CONNECT_HELLO_SENSOR) && (hello_client_free_links() <= 0) &&
+        (blecen_GetScan() == NO_SCAN) && (blecen_GetConn() == NO_CONN) && hello_client_rotate_possible())
+    {
+        blecen_Scan(LOW_SCAN);
+    }
+
+    hello_client_stats_update();
+
+#ifdef HELLO_CLIENT_BENCH
+    hello_client_bench_timeout(count);
+#endif
+
+    if (hello_client.hostinfo_dirty && (count - hello_client.hostinfo_dirty_time >= HELLO_CLIENT_HOSTINFO_FLUSH_DELAY))
+    {
+        hello_client_hostinfo_flush();
+    }
+
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+    hello_client_trace_flush();
+#endif
+
+    // give advertisers which were skipped a chance to be checked again
+    if ((count % HELLO_CLIENT_ADV_CACHE_TIMEOUT) == 0)
+    {
+        hello_client.adv_cache_count = 0;
+        hello_client.adv_cache_next  = 0;
+    }
+
+    if (hello_client_is_idle())
+    {
+        hello_client_timers_stop();
+    }
+}
+
+void hello_client_fine_timeout(UINT32 count)
+{
+}
+
+//
+// Check if there is nothing the timers are needed for.  No links, no connection
+// in progress, nothing queued and nothing to write to the NVRAM.  Scan which
+// backed off to the lowest duty cycle goes on without the timers, it cannot
+// back off any further and the sensor it finds restarts them.
+//
+BOOL hello_client_is_idle(void)
+{
+    return (hello_client.num_peripherals == 0) && (hello_client.num_centrals == 0) &&
+           (hello_client.relay_queued == 0) && (hello_client.reasm_sending == 0) && (hello_client.cmd_count == 0) &&
+           !hello_client.hostinfo_dirty && !hello_client.collecting_candidates &&
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+           (hello_client.trace_count == 0) &&
+#endif
+           (blecen_GetConn() == NO_CONN) &&
+           ((blecen_GetScan() == NO_SCAN) ||
+            ((blecen_GetScan() == LOW_SCAN) && (blecen_cen_cfg.low_scan_interval == HELLO_CLIENT_LOW_SCAN_INTERVAL_MAX)));
+}
+
+//
+// Stop the application timers while there is nothing to do, so that the
+// device can sleep between advertisements.  Timers are restarted when a link
+// comes up, a sensor is found or the button is pushed.
+//
+void hello_client_timers_stop(void)
+{
+    ble_trace0("idle, stop timers\n");
+
+    hello_client.timers_stopped = TRUE;
+    bleprofile_KillTimer();
+}
+
+void hello_client_timers_start(void)
+{
+    if (hello_client.timers_stopped)
+    {
+        hello_client.timers_stopped = FALSE;
+        bleprofile_StartTimer();
+    }
+}
+
+//
+// Firmware asks how long the application can sleep.  Sleep is not allowed while
+// data is waiting for the fine timer to be sent.
+//
+UINT32 hello_client_lpm_query(LowPowerModePollType type, UINT32 context)
+{
+#ifdef HELLO_CLIENT_BENCH
+    // cycle counter stops while the device sleeps
+    return 0;
+#endif
+    if ((hello_client.relay_queued != 0) || (hello_client.cmd_count != 0))
+    {
+        return 0;
+    }
+    return ~0;
+}
+
+#if HELLO_CLIENT_TRACE_LEVEL == 1
+//
+// Save trace to be printed from the application timer, so that the PUART
+// does not slow down the handler
+//
+void hello_client_trace_defer(const char *fmt, UINT32 a, UINT32 b)
+{
+    HELLO_CLIENT_TRACE_ENTRY *p_entry;
+
+    if (hello_client.trace_count == HELLO_CLIENT_TRACE_BUF_SIZE)
+    {
+        hello_client.trace_drops++;
+        return;
+    }
+    p_entry      = &hello_client.trace_buf[hello_client.trace_count++];
+    p_entry->fmt = fmt;
+    p_entry->a   = a;
+    p_entry->b   = b;
+}
+
+void hello_client_trace_flush(void)
+{
+    int i;
+
+    for (i = 0; i < hello_client.trace_count; i++)
+    {
+        ble_trace2(hello_client.trace_buf[i].fmt, hello_client.trace_buf[i].a, hello_client.trace_buf[i].b);
+    }
+    hello_client.trace_count = 0;
+
+    if (hello_client.trace_drops != 0)
+    {
+        ble_trace1("traces lost:%d\n", hello_client.trace_drops);
+        hello_client.trace_drops = 0;
+    }
+}
+#endif
+
+void hello_client_app_timer(UINT32 arg)
+{
+    switch(arg)
+    {
+        case BLEPROFILE_GENERIC_APP_TIMER:
+            {
+                hello_client.app_timer_count++;
+
+                hello_client_timeout(hello_client.app_timer_count);
+            }
+            break;
+    }
+
+    blecen_appTimerCb(arg);
+}
+
+void hello_client_app_fine_timer(UINT32 arg)
+{
+    hello_client.app_fine_timer_count++;
+    hello_client_fine_timeout(hello_client.app_fine_timer_count);
+
+    // collection window is over, start connecting to the sensors found
+    if (hello_client.collecting_candidates &&
+        ((INT32)(hello_client.app_fine_timer_count - hello_client.candidate_deadline) >= 0))
+    {
+        hello_client_state_event(HELLO_CLIENT_EVENT_CANDIDATES);
+    }
+
+    // send queued data if central now has buffers, or aggregated data waited long enough
+    if ((hello_client.relay_queued != 0) || (hello_client.reasm_sending != 0))
+    {
+        hello_client_relay_drain();
+    }
+
+    if (hello_client.app_config & RELAY_SEGMENTED)
+    {
+        hello_client_reasm_timeout();
+    }
+
+    // confirmations held for too long are released even if the queue is still full
+    if (hello_client.confirms_held != 0)
+    {
+        hello_client_relay_release_confirmations();
+    }
+
+    // retry commands which waited for the buffers
+    if (hello_client.cmd_count != 0)
+    {
+        hello_client_cmd_drain();
+    }
+
+    if ((hello_client.num_peripherals != 0) && ((hello_client.app_fine_timer_count % HELLO_CLIENT_RSSI_SAMPLE_TICKS) == 0))
+    {
+        hello_client_rssi_update();
+    }
+}
+
+//
+// Sample RSSI of the sensor links.  Sensor which average stays weak is
+// disconnected while the link still works, so that it, or another sensor of
+// the roster, is reconnected before the data stops for the supervision timeout.
+//
+void hello_client_rssi_update(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        HELLO_CLIENT_LINK_STATS *p_stats = &hello_client.link[i].stats;
+        INT8 rssi;
+
+        if ((p_stats->role != CENTRAL_ROLE) || (hello_client.link[i].peer.con_handle == 0))
+        {
+            continue;
+        }
+
+        rssi = lm_getRSSI((UINT8)hello_client.link[i].peer.con_handle);
+        if (rssi == HELLO_CLIENT_RSSI_INVALID)
+        {
+            continue;
+        }
+
+        if (p_stats->rssi_samples == 0)
+        {
+            p_stats->rssi_avg = rssi * (1 << HELLO_CLIENT_RSSI_SHIFT);
+        }
+        else
+        {
+            p_stats->rssi_avg += rssi - (p_stats->rssi_avg >> HELLO_CLIENT_RSSI_SHIFT);
+        }
+        if (p_stats->rssi_samples != 0xff)
+        {
+            p_stats->rssi_samples++;
+        }
+
+        if ((p_stats->rssi_avg >> HELLO_CLIENT_RSSI_SHIFT) >= HELLO_CLIENT_RSSI_WEAK)
+        {
+            p_stats->rssi_weak = 0;
+            continue;
+        }
+
+        // drop the link only if it had time to recover, and the others can be reconnected
+        if ((++p_stats->rssi_weak >= HELLO_CLIENT_RSSI_WEAK_SAMPLES) &&
+            (hello_client.app_config & AUTO_RECONNECT) &&
+            (hello_client.app_fine_timer_count - p_stats->conn_up_time >= HELLO_CLIENT_RSSI_MIN_LINK_TIME))
+        {
+            ble_trace2("weak link:%d rssi:%d, reconnect\n", i, p_stats->rssi_avg >> HELLO_CLIENT_RSSI_SHIFT);
+
+            p_stats->rssi_weak = 0;
+            blecm_SetPtrConMux(hello_client.link[i].peer.con_handle);
+            blecm_disconnect(BT_ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
+        }
+    }
+}
+
+
+//
+// Process SMP pairing result.  If we successfully paired with the
+// central device, save its BDADDR in the NVRAM and initialize
+// associated data
+//
+void hello_client_smp_pair_result(LESMP_PARING_RESULT  result)
+{
+    blecen_smpBondResult(result);
+
+    if(result == LESMP_PAIRING_RESULT_BONDED)
+    {
+        // if pairing is successful register with the server to receive notification
+        hello_client_peer_secured();
+    }
+}
+
+//
+// Process notification from the stack that encryption has been set.  If connected
+// client is registered for notification or indication, it is a good time to
+// send it out
+//
+void hello_client_encryption_changed(HCI_EVT_HDR *evt)
+{
+    UINT8 status = *((UINT8 *)(evt + 1));
+
+    ble_trace1("encryption changed: %02x\n", status);
+
+    blecen_encryptionChanged(evt);
+
+    // sensor bonded before is encrypted with the saved LTK and no pairing result is
+    // reported, continue as soon as the link is encrypted
+    if (status == 0)
+    {
+        hello_client_peer_secured();
+        hello_client_central_secured();
+    }
+}
+
+//
+// Link to the sensor is encrypted, either with the keys saved from the previous
+// bonding or after new pairing.  Whichever is reported first lets the client
+// register for notifications, the other one is ignored.
+//
+void hello_client_peer_secured(void)
+{
+    int cm_index = hello_client_link_find(emconinfo_getConnHandle());
+
+    if ((cm_index >= 0) && (hello_client.link[cm_index].dev_info.role == CENTRAL_ROLE) &&
+        (hello_client.link[cm_index].peer.disc_state == HELLO_CLIENT_DISC_IDLE))
+    {
+        hello_client_peer_ready(cm_index);
+    }
+}
+
+
+void hello_client_timer_callback(UINT32 arg)
+{
+    ble_trace1("hello_client_timer_callback %d\n", arg);
+
+    switch(arg)
+    {
+    case BLEAPP_APP_TIMER_SCAN:
+        hello_client_state_event(HELLO_CLIENT_EVENT_SCAN_TIMEOUT);
+        break;
+
+    case BLEAPP_APP_TIMER_CONN:
+        if ((blecen_GetConn() == HIGH_CONN) || (blecen_GetConn() == LOW_CONN))
+        {
+            ble_trace0("Connection Fail\n");
+            hello_client_state_event(HELLO_CLIENT_EVENT_CONN_TIMEOUT);
+        }
+        break;
+    }
+}
+
+//
+// Check if advertisement data contains the Hello Sensor service UUID.  Every
+// AD structure is length checked before it is accessed, and UUID is compared
+// only for the complete 128 bit UUID list of the exact length.
+//
+BOOL hello_client_adv_find_hello_service(UINT8 *data, UINT8 len)
+{
+    const UUID128_WORDS *p_hello = (const UUID128_WORDS *)hello_service;
+    const UUID128_WORDS *p_uuid;
+    UINT8 *end = data + len;
+    UINT8 field_len;
+
+    // each AD structure has at least length and type bytes
+    while (data + 2 <= end)
+    {
+        field_len = data[0];
+
+        // zero length is the end of significant data, do not go past the end of a malformed packet
+        if ((field_len == 0) || (data + 1 + field_len > end))
+        {
+            break;
+        }
+
+        if ((field_len == 16 + 1) && (data[1] == ADV_SERVICE_UUID128_COMP))
+        {
+            p_uuid = (const UUID128_WORDS *)&data[2];
+
+            return ((p_uuid->w[0] == p_hello->w[0]) && (p_uuid->w[1] == p_hello->w[1]) &&
+                    (p_uuid->w[2] == p_hello->w[2]) && (p_uuid->w[3] == p_hello->w[3]));
+        }
+        data += field_len + 1;
+    }
+    return FALSE;
+}
+
+//
+// Find advertiser in the cache of the devices which do not publish the Hello
+// Sensor service.  Returns NULL if address is not in the cache.
+//
+HELLO_CLIENT_ADV_CACHE_ENTRY *hello_client_adv_cache_find(UINT8 *bdaddr)
+{
+    const BD_ADDR_WORDS *p_addr = (const BD_ADDR_WORDS *)bdaddr;
+    int i;
+
+    for (i = 0; i < hello_client.adv_cache_count; i++)
+    {
+        const BD_ADDR_WORDS *p_entry = (const BD_ADDR_WORDS *)hello_client.adv_cache[i].bdaddr;
+
+        if ((p_entry->lo == p_addr->lo) && (p_entry->hi == p_addr->hi))
+        {
+            return &hello_client.adv_cache[i];
+        }
+    }
+    return NULL;
+}
+
+//
+// Remember advertiser which did not publish the Hello Sensor service.  Oldest
+// entry is replaced when the cache is full.  Scannable advertisement is a miss
+// only if its scan response does not have the service either, that is known
+// when the scan response or the next advertisement is received.
+//
+void hello_client_adv_cache_add(HELLO_CLIENT_ADV_CACHE_ENTRY *p_entry, UINT8 *bdaddr, UINT8 event_type)
+{
+    BOOL missed = TRUE;
+
+    // scan response of the advertisement which had the service
+    if ((event_type == HELLO_CLIENT_ADV_SCAN_RSP) && ((p_entry == NULL) || !p_entry->adv_missed))
+    {
+        return;
+    }
+
+    if (p_entry == NULL)
+    {
+        p_entry = &hello_client.adv_cache[hello_client.adv_cache_next];
+        memcpy(p_entry->bdaddr, bdaddr, sizeof(BD_ADDR));
+        p_entry->misses     = 0;
+        p_entry->adv_missed = FALSE;
+
+        hello_client.adv_cache_next = (hello_client.adv_cache_next + 1) % HELLO_CLIENT_ADV_CACHE_SIZE;
+        if (hello_client.adv_cache_count < HELLO_CLIENT_ADV_CACHE_SIZE)
+        {
+            hello_client.adv_cache_count++;
+        }
+    }
+
+    if ((event_type == HELLO_CLIENT_ADV_IND) || (event_type == HELLO_CLIENT_ADV_SCAN_IND))
+    {
+        // previous advertisement was not followed by the scan response with the service
+        missed              = p_entry->adv_missed;
+        p_entry->adv_missed = TRUE;
+    }
+    else if (event_type == HELLO_CLIENT_ADV_SCAN_RSP)
+    {
+        p_entry->adv_missed = FALSE;
+    }
+
+    if (missed && (p_entry->misses < HELLO_CLIENT_ADV_CACHE_MISSES))
+    {
+        p_entry->misses++;
+    }
+}
+
+//
+// Number of connections which can still be established with the sensors
+//
+int hello_client_free_links(void)
+{
+    return HELLO_CLIENT_MAX_PERIPHERALS - hello_client.num_peripherals - hello_client.num_centrals;
+}
+
+//
+// Find the central connection with the handle, or a free entry if the handle is 0
+//
+HELLO_CLIENT_CENTRAL *hello_client_central_find(UINT16 con_handle)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        if (hello_client.central[i].con_handle == con_handle)
+        {
+            return &hello_client.central[i];
+        }
+    }
+    return NULL;
+}
+
+//
+// Check if another central can connect, so that the client should advertise
+//
+BOOL hello_client_central_wanted(void)
+{
+    return (hello_client.num_centrals < HELLO_CLIENT_MAX_CENTRALS) && (hello_client_free_links() > 0);
+}
+
+//
+// Check if the sensor with specified address is already connected
+//
+BOOL hello_client_peer_is_connected(UINT8 *bdaddr)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].peer.con_handle != 0) &&
+            (memcmp(hello_client.link[i].peer.bdaddr, bdaddr, sizeof(BD_ADDR)) == 0))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Save sensor found during the scan in the candidate list.  If the list is
+// full, sensor replaces the candidate with the weakest signal.
+//
+void hello_client_candidate_add(HCIULP_ADV_PACKET_REPORT_WDATA *evt)
+{
+    HELLO_CLIENT_CANDIDATE *p_candidate = NULL;
+    int cache_index = hello_client_peer_cache_find(evt->wd_addr);
+    int i;
+
+    // sensor which just gave up its link lets the other sensor use it
+    if (hello_client_peer_is_connected(evt->wd_addr) ||
+        ((cache_index >= 0) && hello_client_rotate_holdoff(cache_index)))
+    {
+        return;
+    }
+
+    for (i = 0; i < hello_client.num_candidates; i++)
+    {
+        if (memcmp(hello_client.candidate[i].bdaddr, evt->wd_addr, sizeof(BD_ADDR)) == 0)
+        {
+            // already in the list, keep the latest RSSI
+            hello_client.candidate[i].rssi = evt->rssi;
+            return;
+        }
+    }
+
+    if (hello_client.num_candidates < HELLO_CLIENT_MAX_PERIPHERALS)
+    {
+        p_candidate = &hello_client.candidate[hello_client.num_candidates++];
+    }
+    else
+    {
+        for (i = 0; i < hello_client.num_candidates; i++)
+        {
+            if ((hello_client.candidate[i].rssi < evt->rssi) &&
+                ((p_candidate == NULL) || (hello_client.candidate[i].rssi < p_candidate->rssi)))
+            {
+                p_candidate = &hello_client.candidate[i];
+            }
+        }
+        if (p_candidate == NULL)
+        {
+            return;
+        }
+    }
+
+    memcpy(p_candidate->bdaddr, evt->wd_addr, sizeof(BD_ADDR));
+    p_candidate->addr_type = evt->addressType;
+    p_candidate->rssi      = evt->rssi;
+
+    hello_client_scan_reset_backoff();
+
+    // first sensor found opens the collection window, scan may have been running without the timers
+    if (!hello_client.collecting_candidates)
+    {
+        hello_client_timers_start();
+        hello_client.collecting_candidates = TRUE;
+        hello_client.candidate_deadline    = hello_client.app_fine_timer_count + HELLO_CLIENT_CANDIDATE_WINDOW;
+    }
+}
+
+void hello_client_candidate_remove(int index)
+{
+    hello_client.num_candidates--;
+    hello_client.candidate[index] = hello_client.candidate[hello_client.num_candidates];
+}
+
+//
+// Connect to the candidate with the strongest signal.  Controller can create
+// one connection at a time, so next candidate is connected as soon as this
+// connection is up or fails, without going through the scan again.  Returns
+// FALSE if there is no candidate to connect.
+//
+BOOL hello_client_connect_next_candidate(void)
+{
+    int   best = -1;
+    int   cache_index;
+    UINT8 conn_mode;
+    int   i;
+
+    hello_client.collecting_candidates = FALSE;
+
+    if (hello_client_free_links() <= 0)
+    {
+        hello_client.num_candidates = 0;
+    }
+
+    for (i = 0; i < hello_client.num_candidates; i++)
+    {
+        if ((best < 0) || (hello_client.candidate[i].rssi > hello_client.candidate[best].rssi))
+        {
+            best = i;
+        }
+    }
+
+    if (best < 0)
+    {
+        return FALSE;
+    }
+
+    ble_trace2("connect candidate:%d rssi:%d\n", best, hello_client.candidate[best].rssi);
+
+    bleprofile_Discoverable(NO_DISCOVERABLE, NULL);
+
+    memcpy(hello_client_target_addr, hello_client.candidate[best].bdaddr, sizeof(BD_ADDR));
+    hello_client_target_addr_type = hello_client.candidate[best].addr_type;
+    hello_client_candidate_remove(best);
+
+    // sensor which was idle on the last connection uses low duty cycle connection parameters
+    cache_index = hello_client_peer_cache_find(hello_client_target_addr);
+    conn_mode   = ((cache_index >= 0) && (hello_client.peer_cache_traffic[cache_index] == HELLO_CLIENT_TRAFFIC_IDLE)) ?
+                  LOW_CONN : HIGH_CONN;
+
+    blecen_Conn(conn_mode, hello_client_target_addr, hello_client_target_addr_type);
+    blecen_Scan(NO_SCAN);
+    return TRUE;
+}
+
+//
+// Check if the sensor gave its link to another sensor a short time ago and
+// should not take a link back yet
+//
+BOOL hello_client_rotate_holdoff(int cache_index)
+{
+    return (hello_client.peer_cache_rotate_time[cache_index] != 0) &&
+           (hello_client.app_timer_count - hello_client.peer_cache_rotate_time[cache_index] < HELLO_CLIENT_ROTATE_HOLDOFF);
+}
+
+//
+// Find the sensor link which was idle for the longest time.  Returns -1 if no
+// link was idle long enough to be given to another sensor.
+//
+int hello_client_rotate_find_idle_link(void)
+{
+    int best = -1;
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        HELLO_CLIENT_LINK *p_link = &hello_client.link[i];
+
+        if ((p_link->stats.role == CENTRAL_ROLE) &&
+            (p_link->peer.disc_state == HELLO_CLIENT_DISC_DONE) &&
+            (p_link->relay_queue.count == 0) &&
+            (p_link->stats.idle_time >= HELLO_CLIENT_ROTATE_IDLE_TIME) &&
+            ((best < 0) || (p_link->stats.idle_time > hello_client.link[best].stats.idle_time)))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+//
+// Check if links are worth rotating, one of the links is idle and a sensor
+// from the roster is not connected
+//
+BOOL hello_client_rotate_possible(void)
+{
+    int i;
+
+    if (hello_client_rotate_find_idle_link() < 0)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < HELLO_CLIENT_PEER_CACHE_SIZE; i++)
+    {
+        if ((hello_client.peer_cache[i].data_descriptor_handle != 0) &&
+            !hello_client_rotate_holdoff(i) &&
+            !hello_client_peer_is_connected(hello_client.peer_cache[i].bdaddr))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// A sensor from the roster advertises while all links are used.  Disconnect the
+// sensor which was idle for the longest time, the advertiser is connected when
+// the scan restarts after the link goes down.
+//
+void hello_client_rotate_to(UINT8 *bdaddr)
+{
+    int cache_index = hello_client_peer_cache_find(bdaddr);
+    int cm_index;
+
+    if ((cache_index < 0) || hello_client_rotate_holdoff(cache_index) || hello_client_peer_is_connected(bdaddr))
+    {
+        return;
+    }
+
+    cm_index = hello_client_rotate_find_idle_link();
+    if (cm_index < 0)
+    {
+        return;
+    }
+
+    ble_trace2("rotate out link:%d idle:%d\n", cm_index, hello_client.link[cm_index].stats.idle_time);
+
+    // sensor which gives up the link waits before it can be connected again
+    cache_index = hello_client_peer_cache_find(hello_client.link[cm_index].peer.bdaddr);
+    if (cache_index >= 0)
+    {
+        hello_client.peer_cache_rotate_time[cache_index] = hello_client.app_timer_count;
+    }
+
+    // no more reports until the link is down
+    blecen_Scan(NO_SCAN);
+
+    blecm_SetPtrConMux(hello_client.link[cm_index].peer.con_handle);
+    blecm_disconnect(BT_ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
+}
+
+void hello_client_advertisement_report(HCIULP_ADV_PACKET_REPORT_WDATA *evt)
+{
+    HELLO_CLIENT_ADV_CACHE_ENTRY *p_entry;
+    UINT8 dataLen = (UINT8)(evt->dataLen);
+
+    // The app may crash because watch dog timer is not getting reset due to a lot of events.
+    // Reset watch dog timer every time we see an advertisement.
+    wdog_restart();
+
+    // make sure that advertisement data is reasonable
+    if (dataLen > HCIULP_MAX_DATA_LENGTH)
+    {
+        return;
+    }
+    blecen_leAdvReportCb(evt);
+
+    // nothing to parse if we are not looking for a sensor, or connection is being established
+    if (!(hello_client.app_config & CONNECT_HELLO_SENSOR) || (blecen_GetConn() != NO_CONN))
+    {
+        return;
+    }
+
+#ifdef HELLO_CLIENT_MIN_RSSI
+    if (evt->rssi < HELLO_CLIENT_MIN_RSSI)      // filter out adverts with low RSSI
+    {
+        return;
+    }
+#endif
+
+    // skip devices which did not publish the service in the advertisement and the scan response
+    p_entry = hello_client_adv_cache_find(evt->wd_addr);
+    if ((p_entry != NULL) && (p_entry->misses >= HELLO_CLIENT_ADV_CACHE_MISSES))
+    {
+        return;
+    }
+
+    // collect sensors found during the scan window, those are connected in order of RSSI
+    if (hello_client_adv_find_hello_service((UINT8 *)(evt->data), dataLen))
+    {
+        HELLO_CLIENT_TRACE0("Found service\n");
+
+        // advertiser publishes the service, earlier misses do not count
+        if (p_entry != NULL)
+        {
+            p_entry->misses     = 0;
+            p_entry->adv_missed = FALSE;
+        }
+
+        // all links are used, sensor from the roster may take the link of an idle sensor
+        if (hello_client_free_links() <= 0)
+        {
+            hello_client_rotate_to(evt->wd_addr);
+            return;
+        }
+
+        hello_client_candidate_add(evt);
+
+        // no need to wait for the end of the window if there is a candidate for every free link
+        if (hello_client.num_candidates >= hello_client_free_links())
+        {
+            hello_client_state_event(HELLO_CLIENT_EVENT_CANDIDATES);
+        }
+    }
+    else
+    {
+        hello_client_adv_cache_add(p_entry, evt->wd_addr, evt->eventType);
+    }
+}
+
+
+//
+// Compute the hash of the peer cache record.  Sensor GATT database does not
+// provide a hash of its own, so the hash covers the discovered handle layout
+// and is used to validate the record read from the NVRAM.
+//
+UINT8 hello_client_peer_cache_hash(HELLO_CLIENT_PEER_CACHE *p_cache)
+{
+    UINT8 *p    = (UINT8 *)p_cache;
+    UINT8  hash = 0x5a;
+    int    i;
+
+    for (i = 0; i < sizeof(HELLO_CLIENT_PEER_CACHE) - 1; i++)
+    {
+        hash = ((hash << 1) | (hash >> 7)) ^ p[i];
+    }
+    return hash;
+}
+
+//
+// Find handles of the sensor with specified BD address in the peer cache.
+// Returns index of the cache entry or -1 if sensor is not in the cache.
+//
+int hello_client_peer_cache_find(UINT8 *bdaddr)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_PEER_CACHE_SIZE; i++)
+    {
+        if ((hello_client.peer_cache[i].data_descriptor_handle != 0) &&
+            (memcmp(hello_client.peer_cache[i].bdaddr, bdaddr, sizeof(BD_ADDR)) == 0))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//
+// Read the peer cache from the NVRAM.  Records which fail the hash check are
+// ignored.
+//
+void hello_client_peer_cache_load(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_PEER_CACHE_SIZE; i++)
+    {
+        HELLO_CLIENT_PEER_CACHE *p_cache = &hello_client.peer_cache[i];
+
+        if ((bleprofile_ReadNVRAM(NVRAM_ID_PEER_CACHE + i, sizeof(HELLO_CLIENT_PEER_CACHE), (UINT8 *)p_cache) != sizeof(HELLO_CLIENT_PEER_CACHE)) ||
+            (p_cache->hash != hello_client_peer_cache_hash(p_cache)))
+        {
+            memset(p_cache, 0, sizeof(HELLO_CLIENT_PEER_CACHE));
+        }
+    }
+}
+
+//
+// Save handles discovered on the peer in the cache and in the NVRAM.  Entry of
+// the same sensor is updated, otherwise an empty entry is taken, and the next
+// entry is replaced only when all entries are in use.
+//
+void hello_client_peer_cache_save(HELLO_CLIENT_PEER *p_peer)
+{
+    HELLO_CLIENT_PEER_CACHE *p_cache;
+    int    index = hello_client_peer_cache_find(p_peer->bdaddr);
+    UINT8  writtenbyte;
+
+    if (index < 0)
+    {
+        for (index = 0; index < HELLO_CLIENT_PEER_CACHE_SIZE; index++)
+        {
+            if (hello_client.peer_cache[index].data_descriptor_handle == 0)
+            {
+                break;
+            }
+        }
+        if (index == HELLO_CLIENT_PEER_CACHE_SIZE)
+        {
+            index = hello_client.peer_cache_next;
+            hello_client.peer_cache_next = (hello_client.peer_cache_next + 1) % HELLO_CLIENT_PEER_CACHE_SIZE;
+        }
+        hello_client.peer_cache_traffic[index]     = HELLO_CLIENT_TRAFFIC_NORMAL;
+        hello_client.peer_cache_rotate_time[index] = 0;
+    }
+
+    p_cache = &hello_client.peer_cache[index];
+    memcpy(p_cache->bdaddr, p_peer->bdaddr, sizeof(BD_ADDR));
+    p_cache->service_start_handle   = p_peer->service_start_handle;
+    p_cache->service_end_handle     = p_peer->service_end_handle;
+    p_cache->data_handle            = p_peer->data_handle;
+    p_cache->config_handle          = p_peer->config_handle;
+    p_cache->data_descriptor_handle = p_peer->data_descriptor_handle;
+    p_cache->config_properties      = p_peer->config_properties;
+    p_cache->addr_type              = p_peer->addr_type;
+    p_cache->priority               = p_peer->priority;
+    p_cache->hash                   = hello_client_peer_cache_hash(p_cache);
+
+    writtenbyte = bleprofile_WriteNVRAM(NVRAM_ID_PEER_CACHE + index, sizeof(HELLO_CLIENT_PEER_CACHE), (UINT8 *)p_cache);
+    ble_trace2("peer cache save:%d NVRAM write:%04x\n", index, writtenbyte);
+}
+
+//
+// Remove stale handles of the sensor from the cache
+//
+void hello_client_peer_cache_delete(UINT8 *bdaddr)
+{
+    int index = hello_client_peer_cache_find(bdaddr);
+
+    if (index >= 0)
+    {
+        memset(&hello_client.peer_cache[index], 0, sizeof(HELLO_CLIENT_PEER_CACHE));
+        bleprofile_DeleteNVRAM(NVRAM_ID_PEER_CACHE + index);
+    }
+}
+
+//
+// Register with the sensor to receive notifications
+//
+void hello_client_peer_enable_notifications(HELLO_CLIENT_PEER *p_peer)
+{
+    UINT16 u16 = 1;
+
+    p_peer->write_outstanding = TRUE;
+    p_peer->write_start       = hello_client.app_timer_count;
+    bleprofile_sendWriteReq(p_peer->data_descriptor_handle, (UINT8 *)&u16, 2);
+}
+
+//
+// Link to the sensor is up and secured if required.  If handles of the sensor
+// are known from the previous connection go straight to the registration for
+// notifications, otherwise start discovery of the Hello Sensor service.
+//
+void hello_client_peer_ready(int cm_index)
+{
+    HELLO_CLIENT_PEER *p_peer = &hello_client.link[cm_index].peer;
+
+    p_peer->disc_start = hello_client.app_timer_count;
+
+    if (p_peer->data_descriptor_handle != 0)
+    {
+        // wait for the write response to make sure that cached handles are still good
+        p_peer->disc_state = HELLO_CLIENT_DISC_VERIFY;
+        hello_client_peer_enable_notifications(p_peer);
+    }
+    else
+    {
+        p_peer->disc_state = HELLO_CLIENT_DISC_SERVICE;
+        bleprofile_sendReadByGroupTypeReq(1, 0xffff, UUID_ATTRIBUTE_PRIMARY_SERVICE);
+    }
+}
+
+//
+// Discovery did not complete or cached handles did not work.  Handles of the
+// sensor with stale cache are rediscovered, otherwise use well known Hello
+// Sensor handles.
+//
+void hello_client_peer_discovery_timeout(int cm_index)
+{
+    HELLO_CLIENT_PEER *p_peer = &hello_client.link[cm_index].peer;
+
+    ble_trace2("discovery timeout handle:%x state:%d\n", p_peer->con_handle, p_peer->disc_state);
+
+    blecm_SetPtrConMux(p_peer->con_handle);
+
+    // response is not coming, do not hold commands waiting for it
+    p_peer->write_outstanding = FALSE;
+
+    if (p_peer->disc_state == HELLO_CLIENT_DISC_VERIFY)
+    {
+        hello_client_peer_cache_delete(p_peer->bdaddr);
+        p_peer->data_descriptor_handle = 0;
+        hello_client_peer_ready(cm_index);
+        return;
+    }
+
+    p_peer->data_handle            = HANDLE_HELLO_SENSOR_VALUE_NOTIFY;
+    p_peer->config_handle          = HANDLE_HELLO_SENSOR_CONFIGURATION;
+    p_peer->config_properties      = LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE;
+    p_peer->data_descriptor_handle = HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR;
+    p_peer->disc_state             = HELLO_CLIENT_DISC_DONE;
+    hello_client_peer_enable_notifications(p_peer);
+}
+
+//
+// Process Read By Group Type response while looking for the Hello Sensor
+// service.  Each entry is start handle, end handle and the service UUID.
+//
+void hello_client_peer_process_service_rsp(HELLO_CLIENT_PEER *p_peer, int len, int attr_len, UINT8 *data)
+{
+    UINT16 start_handle;
+    UINT16 end_handle = 0;
+
+    for (; (attr_len >= 4) && (len >= attr_len); len -= attr_len, data += attr_len)
+    {
+        start_handle = data[0] + (data[1] << 8);
+        end_handle   = data[2] + (data[3] << 8);
+
+        if ((attr_len == 4 + 16) && (memcmp(&data[4], hello_service, 16) == 0))
+        {
+            p_peer->service_start_handle = start_handle;
+            p_peer->service_end_handle   = end_handle;
+            p_peer->disc_state           = HELLO_CLIENT_DISC_CHARACTERISTICS;
+            bleprofile_sendReadByTypeReq(start_handle, end_handle, UUID_ATTRIBUTE_CHARACTERISTIC);
+            return;
+        }
+    }
+
+    // continue with the next services, discovery timeout takes care if there is no such service
+    if ((end_handle != 0) && (end_handle != 0xffff))
+    {
+        bleprofile_sendReadByGroupTypeReq(end_handle + 1, 0xffff, UUID_ATTRIBUTE_PRIMARY_SERVICE);
+    }
+}
+
+//
+// Process Read By Type response for characteristic declarations of the Hello
+// Sensor service.  Each entry is declaration handle, properties, value handle
+// and the characteristic UUID.
+//
+void hello_client_peer_process_characteristic_rsp(HELLO_CLIENT_PEER *p_peer, int len, int attr_len, UINT8 *data)
+{
+    UINT16 handle = 0;
+
+    for (; (attr_len >= 5) && (len >= attr_len); len -= attr_len, data += attr_len)
+    {
+        handle = data[0] + (data[1] << 8);
+
+        if (attr_len == 5 + 16)
+        {
+            if (memcmp(&data[5], hello_characteristic_notify, 16) == 0)
+            {
+                p_peer->data_handle = data[3] + (data[4] << 8);
+            }
+            else if (memcmp(&data[5], hello_characteristic_config, 16) == 0)
+            {
+                p_peer->config_properties = data[2];
+                p_peer->config_handle     = data[3] + (data[4] << 8);
+            }
+        }
+    }
+
+    if ((p_peer->data_handle != 0) && (p_peer->config_handle != 0))
+    {
+        p_peer->disc_state = HELLO_CLIENT_DISC_DESCRIPTOR;
+        bleprofile_sendReadByTypeReq(p_peer->data_handle + 1, p_peer->service_end_handle,
+                                     UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION);
+    }
+    else if ((handle != 0) && (handle < p_peer->service_end_handle))
+    {
+        bleprofile_sendReadByTypeReq(handle + 1, p_peer->service_end_handle, UUID_ATTRIBUTE_CHARACTERISTIC);
+    }
+}
+
+//
+// Process Read By Type response for the client configuration descriptor of the
+// measurement characteristic.  Each entry is descriptor handle and value.
+//
+void hello_client_peer_process_descriptor_rsp(HELLO_CLIENT_PEER *p_peer, int len, int attr_len, UINT8 *data)
+{
+    if ((attr_len < 2) || (len < attr_len))
+    {
+        return;
+    }
+
+    p_peer->data_descriptor_handle = data[0] + (data[1] << 8);
+    p_peer->disc_state             = HELLO_CLIENT_DISC_DONE;
+
+    ble_trace3("discovered data:%04x config:%04x descriptor:%04x\n",
+               p_peer->data_handle, p_peer->config_handle, p_peer->data_descriptor_handle);
+
+    hello_client_peer_cache_save(p_peer);
+    hello_client_peer_enable_notifications(p_peer);
+}
+
+void hello_client_process_rsp(int len, int attr_len, UINT8 *data)
+{
+    int cm_index = hello_client_link_find(emconinfo_getConnHandle());
+    HELLO_CLIENT_PEER *p_peer;
+
+    ble_trace2("Client rsp len:%d attr_len:%d\n", len, attr_len);
+
+    if (cm_index < 0)
+    {
+        return;
+    }
+
+    p_peer = &hello_client.link[cm_index].peer;
+    switch (p_peer->disc_state)
+    {
+    case HELLO_CLIENT_DISC_SERVICE:
+        hello_client_peer_process_service_rsp(p_peer, len, attr_len, data);
+        break;
+
+    case HELLO_CLIENT_DISC_CHARACTERISTICS:
+        hello_client_peer_process_characteristic_rsp(p_peer, len, attr_len, data);
+        break;
+
+    case HELLO_CLIENT_DISC_DESCRIPTOR:
+        hello_client_peer_process_descriptor_rsp(p_peer, len, attr_len, data);
+        break;
+    }
+}
+
+void hello_client_process_write_rsp(void)
+{
+    int cm_index = hello_client_link_find(emconinfo_getConnHandle());
+
+    ble_trace0("Client write rsp\n");
+
+    if (cm_index < 0)
+    {
+        return;
+    }
+    hello_client.link[cm_index].peer.write_outstanding = FALSE;
+
+    // sensor accepted registration with the cached handles
+    if (hello_client.link[cm_index].peer.disc_state == HELLO_CLIENT_DISC_VERIFY)
+    {
+        hello_client.link[cm_index].peer.disc_state = HELLO_CLIENT_DISC_DONE;
+    }
+
+    // next command can be written to this sensor
+    if (hello_client.cmd_count != 0)
+    {
+        hello_client_cmd_drain();
+    }
+}
+
+//
+// Check if a central is connected and subscribed, so that queued data will be sent
+//
+BOOL hello_client_relay_subscribed(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        if ((hello_client.central[i].con_handle != 0) &&
+            (hello_client.central[i].hostinfo.characteristic_client_configuration & (CCC_NOTIFICATION | CCC_INDICATION)))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Check if the central links can take another PDU now.  PDU is sent to all
+// subscribed centrals at once, notifications need a free TX buffer for each
+// of them, and only one indication can be outstanding on a link at a time.
+// TX buffers are one pool of the controller shared by all links, so they are
+// counted without switching to the context of a central.
+//
+BOOL hello_client_relay_can_send(void)
+{
+    int notify = 0;
+    int subscribed = 0;
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        HELLO_CLIENT_CENTRAL *p_central = &hello_client.central[i];
+        UINT16 client_configuration     = p_central->hostinfo.characteristic_client_configuration;
+
+        if (p_central->con_handle == 0)
+        {
+            continue;
+        }
+        if (client_configuration & CCC_NOTIFICATION)
+        {
+            notify++;
+            subscribed++;
+        }
+        else if (client_configuration & CCC_INDICATION)
+        {
+            if (p_central->indication_outstanding)
+            {
+                return FALSE;
+            }
+            subscribed++;
+        }
+    }
+    return (subscribed != 0) && ((notify == 0) || (blecm_getAvailableTxBuffers() >= notify));
+}
+
+//
+// Max value length which fits one notification or indication to every central
+//
+int hello_client_relay_max_len(void)
+{
+    int max_len = HELLO_CLIENT_RELAY_MAX_LEN;
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        if ((hello_client.central[i].con_handle != 0) &&
+            (hello_client.link[hello_client.central[i].cm_index].att_mtu - HELLO_CLIENT_ATT_HDR_LEN < max_len))
+        {
+            max_len = hello_client.link[hello_client.central[i].cm_index].att_mtu - HELLO_CLIENT_ATT_HDR_LEN;
+        }
+    }
+    return max_len;
+}
+
+//
+// Send data received from a peripheral to every subscribed central.  The data
+// pointer references the value in the ATT PDU received from the peripheral, or
+// the entry in the relay queue shared by all centrals, so the application does
+// not copy it; the only copy is done by the stack when it builds the
+// notification in the TX buffer of each central link.  Returns FALSE if the
+// data could not be handed over to the stack.
+//
+BOOL hello_client_relay_to_central(UINT8 *data, int len)
+{
+    HELLO_CLIENT_LINK_STATS *p_stats;
+    int max_len = hello_client_relay_max_len();
+    int i;
+
+    if (!hello_client_relay_can_send())
+    {
+        return FALSE;
+    }
+
+    if (len > max_len)
+    {
+        len = max_len;
+        hello_client.relay_truncated++;
+    }
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        HELLO_CLIENT_CENTRAL *p_central = &hello_client.central[i];
+        UINT16 client_configuration     = p_central->hostinfo.characteristic_client_configuration;
+
+        if ((p_central->con_handle == 0) || !(client_configuration & (CCC_NOTIFICATION | CCC_INDICATION)))
+        {
+            continue;
+        }
+
+        // Because we will be sending on the different connection, change Set Pointer to the central
+        // context.  Skip the search through the connection mux if it is already the current one.
+        if (emconinfo_getConnHandle() != p_central->con_handle)
+        {
+            blecm_SetPtrConMux(p_central->con_handle);
+        }
+
+        p_stats = &hello_client.link[p_central->cm_index].stats;
+        if (p_stats->notifications_out++ == 0)
+        {
+            p_stats->first_notification_time = hello_client.app_fine_timer_count - p_stats->conn_up_time;
+        }
+        p_stats->bytes_out += len;
+
+        if (client_configuration & CCC_NOTIFICATION)
+        {
+            bleprofile_sendNotification(HANDLE_HELLO_CLIENT_DATA_VALUE, data, len);
+        }
+        else
+        {
+            p_central->indication_outstanding = TRUE;
+            p_stats->indication_sent_time     = hello_client.app_fine_timer_count;
+            bleprofile_sendIndication(HANDLE_HELLO_CLIENT_DATA_VALUE, data, len, hello_client_indication_cfm);
+        }
+    }
+    return TRUE;
+}
+
+//
+// Central confirmed the indication, next one can be sent.  Context is set to
+// the central which confirmed.
+//
+void hello_client_indication_cfm(void)
+{
+    HELLO_CLIENT_CENTRAL    *p_central = hello_client_central_find(emconinfo_getConnHandle());
+    HELLO_CLIENT_LINK_STATS *p_stats;
+    UINT32 rtt;
+
+    if (p_central == NULL)
+    {
+        return;
+    }
+
+    // running average of the round trip time
+    p_stats = &hello_client.link[p_central->cm_index].stats;
+    rtt     = hello_client.app_fine_timer_count - p_stats->indication_sent_time;
+    p_stats->indication_rtt += rtt - (p_stats->indication_rtt >> HELLO_CLIENT_STATS_RTT_SHIFT);
+
+    p_central->indication_outstanding = FALSE;
+    hello_client_relay_drain();
+}
+
+//
+// Save data received from a peripheral in the relay queue of that peripheral.
+// If the queue is full the oldest entry is dropped, so the central receives
+// the latest data once it catches up.
+//
+void hello_client_relay_enqueue(int cm_index, UINT16 con_handle, UINT8 *data, int len)
+{
+    HELLO_CLIENT_RELAY_QUEUE *q = &hello_client.link[cm_index].relay_queue;
+    HELLO_CLIENT_RELAY_ENTRY *e;
+
+    if (len > HELLO_CLIENT_RELAY_MAX_LEN)
+    {
+        len = HELLO_CLIENT_RELAY_MAX_LEN;
+        hello_client.relay_truncated++;
+    }
+
+    if (q->count == HELLO_CLIENT_RELAY_QUEUE_DEPTH)
+    {
+        e = &q->entry[q->head];
+        hello_client.relay_queued_bytes -= HELLO_CLIENT_AGGR_HDR_LEN + e->len;
+        q->head = (q->head + 1) % HELLO_CLIENT_RELAY_QUEUE_DEPTH;
+        q->count--;
+        hello_client.link[cm_index].stats.drops++;
+        hello_client.relay_overflow_drops++;
+    }
+    else
+    {
+        if (++hello_client.relay_queued > hello_client.relay_high_water)
+        {
+            hello_client.relay_high_water = hello_client.relay_queued;
+        }
+    }
+
+    e = &q->entry[(q->head + q->count) % HELLO_CLIENT_RELAY_QUEUE_DEPTH];
+    e->con_handle = (UINT8)con_handle;
+    e->len        = (UINT8)len;
+    memcpy(e->data, data, len);
+#ifdef HELLO_CLIENT_BENCH
+    e->arrival    = HELLO_CLIENT_CYCLES();
+#endif
+    q->count++;
+
+    if (hello_client.relay_queued_bytes == 0)
+    {
+        hello_client.aggr_deadline = hello_client.app_fine_timer_count + hello_client.aggr_flush_ticks;
+    }
+    hello_client.relay_queued_bytes += HELLO_CLIENT_AGGR_HDR_LEN + len;
+}
+
+//
+// Check if the link is a sensor in the alarm class.  Peer of a link which is
+// down is cleared to 0, which is the alarm class, so the role is checked too.
+//
+BOOL hello_client_relay_is_alarm(int cm_index)
+{
+    return (hello_client.link[cm_index].stats.role == CENTRAL_ROLE) &&
+           (hello_client.link[cm_index].peer.priority == HELLO_CLIENT_PRIORITY_ALARM);
+}
+
+//
+// Return the queue to be served next.  Queues of the alarm sensors are served
+// first, round robin between them.  Other queues are served by deficit round
+// robin, every queue gets the quantum of its class in each round and sends
+// while it has enough, so that a busy peripheral does not take all the
+// upstream bandwidth.
+//
+HELLO_CLIENT_RELAY_QUEUE *hello_client_relay_next_queue(void)
+{
+    HELLO_CLIENT_RELAY_QUEUE *q;
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        int cm_index = (hello_client.relay_rr_alarm + i) % HELLO_CLIENT_MAX_PERIPHERALS;
+
+        q = &hello_client.link[cm_index].relay_queue;
+        if ((q->count != 0) && hello_client_relay_is_alarm(cm_index))
+        {
+            hello_client.relay_rr_alarm = (cm_index + 1) % HELLO_CLIENT_MAX_PERIPHERALS;
+            return q;
+        }
+    }
+
+    // quantum is not smaller than an entry, so the queue can send once it is credited
+    for (i = 0; i <= HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        HELLO_CLIENT_PEER *p_peer = &hello_client.link[hello_client.relay_rr].peer;
+
+        q = &hello_client.link[hello_client.relay_rr].relay_queue;
+        if ((q->count != 0) && !hello_client_relay_is_alarm(hello_client.relay_rr))
+        {
+            if ((q->deficit < q->entry[q->head].len) && !hello_client.relay_rr_credited)
+            {
+                q->deficit += (p_peer->priority == HELLO_CLIENT_PRIORITY_BULK) ?
+                              HELLO_CLIENT_QUANTUM_BULK : HELLO_CLIENT_QUANTUM_NORMAL;
+                hello_client.relay_rr_credited = TRUE;
+            }
+            if (q->deficit >= q->entry[q->head].len)
+            {
+                return q;
+            }
+        }
+
+        hello_client.relay_rr          = (hello_client.relay_rr + 1) % HELLO_CLIENT_MAX_PERIPHERALS;
+        hello_client.relay_rr_credited = FALSE;
+    }
+    return NULL;
+}
+
+void hello_client_relay_dequeue(HELLO_CLIENT_RELAY_QUEUE *q)
+{
+    UINT8 len = q->entry[q->head].len;
+
+#ifdef HELLO_CLIENT_BENCH
+    hello_client_bench_relayed(q->entry[q->head].data, len, q->entry[q->head].arrival);
+#endif
+
+    hello_client.relay_queued_bytes -= HELLO_CLIENT_AGGR_HDR_LEN + len;
+    hello_client.relay_queued--;
+    q->head = (q->head + 1) % HELLO_CLIENT_RELAY_QUEUE_DEPTH;
+    q->count--;
+
+    // queue which has nothing to send does not keep its credit to the next round
+    q->deficit = ((q->count != 0) && (q->deficit > len)) ? (q->deficit - len) : 0;
+}
+
+//
+// Check if data from an alarm sensor is waiting
+//
+BOOL hello_client_relay_alarm_queued(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].relay_queue.count != 0) && hello_client_relay_is_alarm(i))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Drop data still queued from a sensor which link went down, so that the
+// next sensor on the link does not inherit the entries and the credit
+//
+void hello_client_relay_queue_reset(int cm_index)
+{
+    HELLO_CLIENT_RELAY_QUEUE *q = &hello_client.link[cm_index].relay_queue;
+    int i;
+
+    for (i = 0; i < q->count; i++)
+    {
+        hello_client.relay_queued_bytes -= HELLO_CLIENT_AGGR_HDR_LEN + q->entry[(q->head + i) % HELLO_CLIENT_RELAY_QUEUE_DEPTH].len;
+    }
+    hello_client.relay_queued          -= q->count;
+    hello_client.relay_link_down_drops += q->count;
+
+    q->head    = 0;
+    q->count   = 0;
+    q->deficit = 0;
+}
+
+//
+// Build a PDU of the records from the queues.  Records are taken round robin
+// while they fit.  Returns the PDU length.
+//
+int hello_client_relay_aggregate(UINT8 *pdu)
+{
+    HELLO_CLIENT_RELAY_QUEUE *q;
+    HELLO_CLIENT_RELAY_ENTRY *e;
+    int len = 0;
+    int record_len;
+
+    while ((q = hello_client_relay_next_queue()) != NULL)
+    {
+        e = &q->entry[q->head];
+
+        // every record is tagged, so the ones which do not fit are truncated like in the non aggregated mode
+        record_len = e->len;
+        if (record_len > HELLO_CLIENT_RELAY_MAX_LEN - HELLO_CLIENT_AGGR_HDR_LEN)
+        {
+            record_len = HELLO_CLIENT_RELAY_MAX_LEN - HELLO_CLIENT_AGGR_HDR_LEN;
+        }
+        if (len + HELLO_CLIENT_AGGR_HDR_LEN + record_len > HELLO_CLIENT_RELAY_MAX_LEN)
+        {
+            break;
+        }
+
+        pdu[len++] = e->con_handle;
+        pdu[len++] = (UINT8)record_len;
+        memcpy(&pdu[len], e->data, record_len);
+        len += record_len;
+
+        hello_client_relay_dequeue(q);
+    }
+    return len;
+}
+
+//
+// Send the queued data to the central while it can take it.  In the
+// RELAY_AGGREGATE mode the PDU is sent when enough data is collected or
+// when the fine timer deadline expires.
+//
+void hello_client_relay_drain(void)
+{
+    HELLO_CLIENT_RELAY_QUEUE *q;
+    UINT8 pdu[HELLO_CLIENT_RELAY_MAX_LEN];
+    int   len;
+
+    if (hello_client.reasm_sending != 0)
+    {
+        hello_client_reasm_drain();
+    }
+
+    while ((hello_client.relay_queued != 0) && hello_client_relay_can_send())
+    {
+        if (hello_client.app_config & RELAY_AGGREGATE)
+        {
+            // alarm does not wait for the aggregation deadline
+            if ((hello_client.relay_queued_bytes < hello_client.aggr_flush_threshold) &&
+                ((INT32)(hello_client.app_fine_timer_count - hello_client.aggr_deadline) < 0) &&
+                !hello_client_relay_alarm_queued())
+            {
+                break;
+            }
+            len = hello_client_relay_aggregate(pdu);
+            hello_client_relay_to_central(pdu, len);
+
+            hello_client.aggr_deadline = hello_client.app_fine_timer_count + hello_client.aggr_flush_ticks;
+        }
+        else
+        {
+            q = hello_client_relay_next_queue();
+            hello_client_relay_to_central(q->entry[q->head].data, q->entry[q->head].len);
+            hello_client_relay_dequeue(q);
+        }
+    }
+
+    if (hello_client.confirms_held != 0)
+    {
+        hello_client_relay_release_confirmations();
+    }
+}
+
+//
+// Confirm indications to the sensors which queues have space again.  Sensor
+// does not send next indication before the confirmation, so holding it slows
+// the sensor down instead of dropping its data.  Confirmation is not held when
+// no central takes the data, or for longer than HELLO_CLIENT_CONFIRM_HOLD_TICKS,
+// so that the sensor does not drop the link on the ATT timeout.  Connection
+// mux context of the caller is restored at the end.
+//
+void hello_client_relay_release_confirmations(void)
+{
+    UINT16 con_handle = emconinfo_getConnHandle();
+    BOOL   subscribed = hello_client_relay_subscribed();
+    int    i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        HELLO_CLIENT_LINK *p_link = &hello_client.link[i];
+
+        if (blecm_getAvailableTxBuffers() == 0)
+        {
+            break;
+        }
+        if (p_link->peer.confirm_held &&
+            ((p_link->relay_queue.count < HELLO_CLIENT_RELAY_QUEUE_DEPTH) || !subscribed ||
+             (hello_client.app_fine_timer_count - p_link->peer.confirm_held_time >= HELLO_CLIENT_CONFIRM_HOLD_TICKS)))
+        {
+            p_link->peer.confirm_held = FALSE;
+            hello_client.confirms_held--;
+
+            blecm_SetPtrConMux(p_link->peer.con_handle);
+            bleprofile_sendHandleValueConf();
+        }
+    }
+
+    if (emconinfo_getConnHandle() != con_handle)
+    {
+        blecm_SetPtrConMux(con_handle);
+    }
+}
+
+//
+// Find the buffer in which the record from the link is being reassembled
+//
+HELLO_CLIENT_REASM_BUF *hello_client_reasm_find(int cm_index)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_REASM_POOL_SIZE; i++)
+    {
+        if ((hello_client.reasm[i].state == HELLO_CLIENT_REASM_RECEIVING) && (hello_client.reasm[i].cm_index == cm_index))
+        {
+            return &hello_client.reasm[i];
+        }
+    }
+    return NULL;
+}
+
+HELLO_CLIENT_REASM_BUF *hello_client_reasm_alloc(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_REASM_POOL_SIZE; i++)
+    {
+        if (hello_client.reasm[i].state == HELLO_CLIENT_REASM_FREE)
+        {
+            return &hello_client.reasm[i];
+        }
+    }
+    return NULL;
+}
+
+void hello_client_reasm_drop(HELLO_CLIENT_REASM_BUF *p)
+{
+    p->state = HELLO_CLIENT_REASM_FREE;
+    hello_client.reasm_drops++;
+}
+
+//
+// Add segment received from the sensor to the record being reassembled.  Record
+// with a lost segment is dropped.  Complete record is sent to the central
+// segmented for the central link MTU.
+//
+void hello_client_reasm_receive(int cm_index, UINT8 *data, int len)
+{
+    HELLO_CLIENT_REASM_BUF *p = hello_client_reasm_find(cm_index);
+    UINT8 hdr = data[0];
+
+    data++;
+    len--;
+
+    if (hdr & HELLO_SENSOR_SEG_FIRST)
+    {
+        // previous record from this sensor was not finished
+        if (p != NULL)
+        {
+            hello_client_reasm_drop(p);
+        }
+        p = hello_client_reasm_alloc();
+        if (p == NULL)
+        {
+            hello_client.reasm_drops++;
+            return;
+        }
+        p->state    = HELLO_CLIENT_REASM_RECEIVING;
+        p->cm_index = cm_index;
+        p->len      = 0;
+        p->seq      = 0;
+    }
+    else if (p == NULL)
+    {
+        return;
+    }
+
+    if (((hdr & HELLO_SENSOR_SEG_SEQ_MASK) != p->seq) || (p->len + len > HELLO_CLIENT_REASM_MAX_LEN))
+    {
+        hello_client_reasm_drop(p);
+        return;
+    }
+
+    memcpy(&p->data[p->len], data, len);
+    p->len     += len;
+    p->seq      = (p->seq + 1) & HELLO_SENSOR_SEG_SEQ_MASK;
+    p->deadline = hello_client.app_fine_timer_count + HELLO_CLIENT_REASM_TIMEOUT;
+
+    if (hdr & HELLO_SENSOR_SEG_LAST)
+    {
+        p->state = HELLO_CLIENT_REASM_SENDING;
+        p->sent  = 0;
+        p->seq   = 0;
+        hello_client.reasm_sending++;
+
+        hello_client_relay_drain();
+    }
+}
+
+//
+// Send segments of the complete records to the central.  Segments of one record
+// are sent before the next record is started.
+//
+void hello_client_reasm_drain(void)
+{
+    UINT8 pdu[HELLO_CLIENT_RELAY_MAX_LEN];
+    int   i;
+
+    while ((hello_client.reasm_sending != 0) && hello_client_relay_can_send())
+    {
+        HELLO_CLIENT_REASM_BUF *p;
+        UINT8 hdr;
+        int   len;
+
+        if (hello_client.reasm_current == HELLO_CLIENT_REASM_NONE)
+        {
+            for (i = 0; i < HELLO_CLIENT_REASM_POOL_SIZE; i++)
+            {
+                if (hello_client.reasm[i].state == HELLO_CLIENT_REASM_SENDING)
+                {
+                    hello_client.reasm_current = i;
+                    break;
+                }
+            }
+        }
+        p = &hello_client.reasm[hello_client.reasm_current];
+
+        len = hello_client_relay_max_len() - 1;
+        if (len > p->len - p->sent)
+        {
+            len = p->len - p->sent;
+        }
+
+        hdr = p->seq;
+        if (p->sent == 0)
+        {
+            hdr |= HELLO_SENSOR_SEG_FIRST;
+        }
+        if (p->sent + len == p->len)
+        {
+            hdr |= HELLO_SENSOR_SEG_LAST;
+        }
+
+        pdu[0] = hdr;
+        memcpy(&pdu[1], &p->data[p->sent], len);
+        hello_client_relay_to_central(pdu, len + 1);
+
+        p->sent += len;
+        p->seq   = (p->seq + 1) & HELLO_SENSOR_SEG_SEQ_MASK;
+
+        if (p->sent == p->len)
+        {
+            p->state = HELLO_CLIENT_REASM_FREE;
+            hello_client.reasm_sending--;
+            hello_client.reasm_current = HELLO_CLIENT_REASM_NONE;
+        }
+    }
+}
+
+//
+// Drop records which sensor did not finish in time
+//
+void hello_client_reasm_timeout(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_REASM_POOL_SIZE; i++)
+    {
+        if ((hello_client.reasm[i].state == HELLO_CLIENT_REASM_RECEIVING) &&
+            ((INT32)(hello_client.app_fine_timer_count - hello_client.reasm[i].deadline) >= 0))
+        {
+            ble_trace1("reassembly timeout link:%d\n", hello_client.reasm[i].cm_index);
+            hello_client_reasm_drop(&hello_client.reasm[i]);
+        }
+    }
+}
+
+void hello_client_process_data_from_peripheral(int len, UINT8 *data)
+{
+    // context is still set to the peripheral which sent the data
+    UINT16 con_handle = emconinfo_getConnHandle();
+    int    cm_index   = hello_client_link_find(con_handle);
+    HELLO_CLIENT_LINK_STATS *p_stats;
+#ifdef HELLO_CLIENT_BENCH
+    UINT32 arrival    = HELLO_CLIENT_CYCLES();
+#endif
+
+    if (cm_index < 0)
+    {
+        return;
+    }
+
+    p_stats = &hello_client.link[cm_index].stats;
+    if (p_stats->notifications_in++ == 0)
+    {
+        p_stats->first_notification_time = hello_client.app_fine_timer_count - p_stats->conn_up_time;
+    }
+    p_stats->bytes_in += len;
+
+#ifdef HELLO_CLIENT_BENCH
+    hello_client_bench_receive(cm_index, data, len);
+#endif
+
+    // segments of a larger record are reassembled, record which fits one notification is relayed as is
+    if ((hello_client.app_config & RELAY_SEGMENTED) && (len > 0) &&
+        ((data[0] & (HELLO_SENSOR_SEG_FIRST | HELLO_SENSOR_SEG_LAST)) != (HELLO_SENSOR_SEG_FIRST | HELLO_SENSOR_SEG_LAST)))
+    {
+        hello_client_reasm_receive(cm_index, data, len);
+        return;
+    }
+
+    // if nothing is waiting, forward received data directly from the received PDU,
+    // reassembled records go first so that the order of the sensor is kept
+    if ((hello_client.relay_queued == 0) && (hello_client.reasm_sending == 0) &&
+        !(hello_client.app_config & RELAY_AGGREGATE) && hello_client_relay_to_central(data, len))
+    {
+#ifdef HELLO_CLIENT_BENCH
+        hello_client_bench_relayed(data, len, arrival);
+#endif
+        return;
+    }
+
+    hello_client_relay_enqueue(cm_index, con_handle, data, len);
+    hello_client_relay_drain();
+}
+
+void hello_client_notification_handler(int len, int attr_len, UINT8 *data)
+{
+    HELLO_CLIENT_TRACE2("Notification:%02x, %d\n", (UINT16)attr_len, len);
+    HELLO_CLIENT_TRACEN(data, len);
+
+    hello_client_process_data_from_peripheral(len, data);
+}
+
+void hello_client_indication_handler(int len, int attr_len, UINT8 *data)
+{
+    // relay to the central switches the context, keep the sensor which sent the indication
+    UINT16 con_handle = emconinfo_getConnHandle();
+    int    cm_index   = hello_client_link_find(con_handle);
+
+    HELLO_CLIENT_TRACE2("Indication:%02x, %d\n", (UINT16)attr_len, len);
+    HELLO_CLIENT_TRACEN(data, len);
+
+    hello_client_process_data_from_peripheral(len, data);
+
+    // if data had to be queued and the queue is full now, sensor is confirmed when the queue drains.
+    // Relay may have taken the last TX buffer, then the confirmation waits for one.
+    if ((cm_index >= 0) &&
+        (((hello_client.link[cm_index].relay_queue.count >= HELLO_CLIENT_RELAY_QUEUE_DEPTH) && hello_client_relay_subscribed()) ||
+         (blecm_getAvailableTxBuffers() == 0)))
+    {
+        hello_client.link[cm_index].peer.confirm_held      = TRUE;
+        hello_client.link[cm_index].peer.confirm_held_time = hello_client.app_fine_timer_count;
+        hello_client.confirms_held++;
+        return;
+    }
+
+    if (emconinfo_getConnHandle() != con_handle)
+    {
+        blecm_SetPtrConMux(con_handle);
+    }
+    bleprofile_sendHandleValueConf();
+}
+
+//
+// Put counters of the selected connection into the statistics characteristic
+//
+void hello_client_stats_update(void)
+{
+    HELLO_CLIENT_LINK_STATS   *p_stats;
+    HELLO_CLIENT_STATS_RECORD *p_record;
+    BLEPROFILE_DB_PDU          db_pdu;
+
+#ifdef HELLO_CLIENT_PROFILE
+    if (hello_client.stats_index >= HELLO_CLIENT_PROFILE_SELECT)
+    {
+        hello_client_profile_update();
+        return;
+    }
+#endif
+    p_stats = &hello_client.link[hello_client.stats_index].stats;
+
+    p_record = (HELLO_CLIENT_STATS_RECORD *)db_pdu.pdu;
+    p_record->index                   = hello_client.stats_index;
+    p_record->role                    = p_stats->role;
+    p_record->notifications_in        = p_stats->notifications_in;
+    p_record->notifications_out       = p_stats->notifications_out;
+    p_record->drops                   = p_stats->drops;
+    p_record->bytes_in                = p_stats->bytes_in;
+    p_record->bytes_out               = p_stats->bytes_out;
+    p_record->indication_rtt          = (p_stats->indication_rtt * HELLO_CLIENT_FINE_TIMER_INTERVAL) >> HELLO_CLIENT_STATS_RTT_SHIFT;
+    p_record->first_notification_time = p_stats->first_notification_time * HELLO_CLIENT_FINE_TIMER_INTERVAL;
+
+    db_pdu.len = sizeof(HELLO_CLIENT_STATS_RECORD);
+    bleprofile_WriteHandle(HANDLE_HELLO_CLIENT_STATS_VALUE, &db_pdu);
+}
+
+//
+// Read the configuration saved in the NVRAM and apply it.  Configuration of the
+// build is kept, so that it can be restored.
+//
+void hello_client_config_load(void)
+{
+    HELLO_CLIENT_CONFIG_RECORD *p = &hello_client.config_default;
+
+    p->version                  = HELLO_CLIENT_CONFIG_VERSION;
+    p->high_scan_interval       = blecen_cen_cfg.high_scan_interval;
+    p->high_scan_window         = blecen_cen_cfg.high_scan_window;
+    p->low_scan_interval        = blecen_cen_cfg.low_scan_interval;
+    p->low_scan_window          = blecen_cen_cfg.low_scan_window;
+    p->high_conn_min_interval   = blecen_cen_cfg.high_conn_min_interval;
+    p->high_conn_max_interval   = blecen_cen_cfg.high_conn_max_interval;
+    p->high_supervision_timeout = blecen_cen_cfg.high_supervision_timeout;
+    p->low_supervision_timeout  = blecen_cen_cfg.low_supervision_timeout;
+    p->aggr_flush_threshold     = HELLO_CLIENT_AGGR_FLUSH_THRESHOLD;
+    p->aggr_flush_ticks         = HELLO_CLIENT_AGGR_FLUSH_TICKS;
+
+    if ((bleprofile_ReadNVRAM(NVRAM_ID_CONFIG, sizeof(HELLO_CLIENT_CONFIG_RECORD), (UINT8 *)&hello_client.config) != sizeof(HELLO_CLIENT_CONFIG_RECORD)) ||
+        !hello_client_config_valid(&hello_client.config))
+    {
+        hello_client.config = hello_client.config_default;
+    }
+    hello_client_config_apply();
+}
+
+//
+// Check that the configuration is what the controller accepts, and that the
+// supervision timeout is longer than two connection intervals
+//
+BOOL hello_client_config_valid(HELLO_CLIENT_CONFIG_RECORD *p)
+{
+    return (p->version == HELLO_CLIENT_CONFIG_VERSION) &&
+           (p->high_scan_window >= 4) && (p->high_scan_window <= p->high_scan_interval) && (p->high_scan_interval <= 16384) &&
+           (p->low_scan_window >= 4) && (p->low_scan_window <= p->low_scan_interval) && (p->low_scan_interval <= HELLO_CLIENT_LOW_SCAN_INTERVAL_MAX) &&
+           (p->high_conn_min_interval >= 6) && (p->high_conn_min_interval <= p->high_conn_max_interval) && (p->high_conn_max_interval <= 3200) &&
+           (p->high_supervision_timeout >= 10) && (p->high_supervision_timeout <= 3200) &&
+           (p->low_supervision_timeout >= 10) && (p->low_supervision_timeout <= 3200) &&
+           ((UINT32)p->high_supervision_timeout * 4 > p->high_conn_max_interval) &&
+           ((UINT32)p->low_supervision_timeout * 4 > blecen_cen_cfg.low_conn_max_interval) &&
+           (p->aggr_flush_threshold <= HELLO_CLIENT_RELAY_MAX_LEN) && (p->aggr_flush_ticks != 0);
+}
+
+//
+// Use the configuration from now on.  Scan in progress is restarted with the
+// new parameters, connections which are up keep the parameters they were
+// created with.
+//
+void hello_client_config_apply(void)
+{
+    HELLO_CLIENT_CONFIG_RECORD *p = &hello_client.config;
+    UINT8 scan = blecen_GetScan();
+
+    blecen_cen_cfg.high_scan_interval       = p->high_scan_interval;
+    blecen_cen_cfg.high_scan_window         = p->high_scan_window;
+    blecen_cen_cfg.low_scan_interval        = p->low_scan_interval;
+    blecen_cen_cfg.low_scan_window          = p->low_scan_window;
+    blecen_cen_cfg.high_conn_min_interval   = p->high_conn_min_interval;
+    blecen_cen_cfg.high_conn_max_interval   = p->high_conn_max_interval;
+    blecen_cen_cfg.high_supervision_timeout = p->high_supervision_timeout;
+    blecen_cen_cfg.low_supervision_timeout  = p->low_supervision_timeout;
+    hello_client.low_scan_interval          = p->low_scan_interval;
+    hello_client.aggr_flush_threshold       = p->aggr_flush_threshold;
+    hello_client.aggr_flush_ticks           = p->aggr_flush_ticks;
+
+    if (scan != NO_SCAN)
+    {
+        blecen_Scan(NO_SCAN);
+        blecen_Scan(scan);
+    }
+
+    hello_client_config_update();
+}
+
+//
+// Put the configuration in use into the configuration characteristic
+//
+void hello_client_config_update(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    memcpy(db_pdu.pdu, &hello_client.config, sizeof(HELLO_CLIENT_CONFIG_RECORD));
+    db_pdu.len = sizeof(HELLO_CLIENT_CONFIG_RECORD);
+    bleprofile_WriteHandle(HANDLE_HELLO_CLIENT_CONFIG_VALUE, &db_pdu);
+}
+
+//
+// Host info changed, it is written to the NVRAM when changes settle
+//
+void hello_client_hostinfo_changed(HELLO_CLIENT_CENTRAL *p_central)
+{
+    if (p_central->host_index == HELLO_CLIENT_NO_HOST)
+    {
+        return;
+    }
+    hello_client.host_list[p_central->host_index] = p_central->hostinfo;
+    hello_client.hostinfo_dirty      = TRUE;
+    hello_client.hostinfo_dirty_time = hello_client.app_timer_count;
+}
+
+//
+// Check if the host_list entry belongs to a connected central
+//
+BOOL hello_client_host_in_use(int index)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
+    {
+        if ((hello_client.central[i].con_handle != 0) && (hello_client.central[i].host_index == index))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//
+// Link to the central is encrypted.  Client configuration saved for the central
+// is restored only now, so that a device which uses the address of a bonded
+// central does not get the data over an unencrypted link.
+//
+void hello_client_central_secured(void)
+{
+    UINT16 con_handle               = emconinfo_getConnHandle();
+    HELLO_CLIENT_CENTRAL *p_central = (con_handle != 0) ? hello_client_central_find(con_handle) : NULL;
+
+    // restored once, encryption refresh on the same link does not change it
+    if ((p_central == NULL) || (p_central->host_index != HELLO_CLIENT_NO_HOST))
+    {
+        return;
+    }
+
+    hello_client_hostinfo_restore(p_central, (UINT8 *)emconninfo_getPeerPubAddr());
+
+    // central registered before, send out data collected while it was away
+    hello_client_relay_drain();
+}
+
+//
+// Central link is encrypted.  Restore client configuration saved for this
+// central, so that data is relayed right away instead of after the central
+// writes the descriptor again.  New central replaces an entry with nothing to
+// restore, or the next entry, which is not used by another connected central.
+// Central without a public address is not remembered.
+//
+void hello_client_hostinfo_restore(HELLO_CLIENT_CENTRAL *p_central, UINT8 *bdaddr)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    int index = -1;
+    int i;
+
+    if (memcmp(bdaddr, bd_addr_none, sizeof(BD_ADDR)) == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < HELLO_CLIENT_MAX_HOSTS; i++)
+    {
+        // empty entries do not match
+        if ((memcmp(hello_client.host_list[i].bdaddr, bd_addr_none, sizeof(BD_ADDR)) != 0) &&
+            (memcmp(hello_client.host_list[i].bdaddr, bdaddr, sizeof(BD_ADDR)) == 0))
+        {
+            index = i;
+            break;
+        }
+        if ((index < 0) && (hello_client.host_list[i].characteristic_client_configuration == 0) &&
+            !hello_client_host_in_use(i))
+        {
+            index = i;
+        }
+    }
+    if ((i == HELLO_CLIENT_MAX_HOSTS) && (index < 0))
+    {
+        do
+        {
+            index = hello_client.host_next;
+            hello_client.host_next = (hello_client.host_next + 1) % HELLO_CLIENT_MAX_HOSTS;
+        } while (hello_client_host_in_use(index));
+    }
+
+    p_central->host_index = index;
+    if (i == HELLO_CLIENT_MAX_HOSTS)
+    {
+        memcpy(p_central->hostinfo.bdaddr, bdaddr, sizeof(BD_ADDR));
+        p_central->hostinfo.characteristic_client_configuration = 0;
+        hello_client_hostinfo_changed(p_central);
+    }
+    else
+    {
+        p_central->hostinfo = hello_client.host_list[index];
+    }
+
+    ble_trace2("host:%d client_configuration:%04x\n", index, p_central->hostinfo.characteristic_client_configuration);
+
+    // GATT database holds one descriptor value, it shows the last central connected
+    db_pdu.len    = 2;
+    db_pdu.pdu[0] = p_central->hostinfo.characteristic_client_configuration & 0xff;
+    db_pdu.pdu[1] = p_central->hostinfo.characteristic_client_configuration >> 8;
+    bleprofile_WriteHandle(HANDLE_HELLO_CLIENT_CLIENT_CONFIGURATION_DESCRIPTOR, &db_pdu);
+}
+
+//
+// Write host info to the NVRAM if it changed
+//
+void hello_client_hostinfo_flush(void)
+{
+    UINT8 writtenbyte;
+
+    if (!hello_client.hostinfo_dirty)
+    {
+        return;
+    }
+    hello_client.hostinfo_dirty = FALSE;
+
+    writtenbyte = bleprofile_WriteNVRAM(NVRAM_ID_HOST_LIST, sizeof(hello_client.host_list), (UINT8 *)hello_client.host_list);
+    ble_trace1("host info NVRAM write:%04x\n", writtenbyte);
+}
+
+//
+// Change priority class of the connected sensor.  Class is saved with the
+// handles, so that it is used again when the sensor reconnects.
+//
+void hello_client_set_priority(UINT8 cm_index, UINT8 priority)
+{
+    HELLO_CLIENT_PEER *p_peer;
+
+    if ((cm_index >= HELLO_CLIENT_MAX_PERIPHERALS) || (priority >= HELLO_CLIENT_PRIORITY_NUM) ||
+        (hello_client.link[cm_index].stats.role != CENTRAL_ROLE))
+    {
+        HELLO_CLIENT_TRACE2("priority bad link:%d class:%d\n", cm_index, priority);
+        return;
+    }
+
+    p_peer = &hello_client.link[cm_index].peer;
+    if (p_peer->priority != priority)
+    {
+        p_peer->priority = priority;
+        if (hello_client_peer_cache_find(p_peer->bdaddr) >= 0)
+        {
+            hello_client_peer_cache_save(p_peer);
+        }
+    }
+}
+
+//
+// Queue command written by the central for the target sensor, or for all
+// sensors if target is HELLO_CLIENT_CMD_TARGET_ALL
+//
+void hello_client_cmd_enqueue(UINT8 target, UINT8 *data, int len)
+{
+    HELLO_CLIENT_CMD_ENTRY *e;
+    UINT8 pending = 0;
+    int   i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].stats.role == CENTRAL_ROLE) &&
+            ((target == HELLO_CLIENT_CMD_TARGET_ALL) || (target == i)))
+        {
+            pending |= 1 << i;
+        }
+    }
+
+    if ((pending == 0) || (len > HELLO_CLIENT_CMD_MAX_LEN))
+    {
+        HELLO_CLIENT_TRACE2("cmd bad target:%d len:%d\n", target, len);
+        return;
+    }
+    if (hello_client.cmd_count == HELLO_CLIENT_CMD_QUEUE_DEPTH)
+    {
+        hello_client.cmd_drops++;
+        return;
+    }
+
+    e = &hello_client.cmd_queue[(hello_client.cmd_head + hello_client.cmd_count) % HELLO_CLIENT_CMD_QUEUE_DEPTH];
+    e->pending = pending;
+    e->len     = len;
+    memcpy(e->data, data, len);
+    hello_client.cmd_count++;
+}
+
+//
+// Write command to the configuration characteristic of the sensor.  Write
+// command is used if sensor allows it, so that sensor does not need to
+// respond.  Otherwise only one write request is outstanding on the link.
+// TX buffer pool is shared by all links, it is checked in any context.
+// Returns FALSE if command cannot be sent now.
+//
+BOOL hello_client_cmd_send(HELLO_CLIENT_PEER *p_peer, HELLO_CLIENT_CMD_ENTRY *e)
+{
+    if ((p_peer->disc_state != HELLO_CLIENT_DISC_DONE) || (blecm_getAvailableTxBuffers() == 0))
+    {
+        return FALSE;
+    }
+
+    if (p_peer->config_properties & LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE)
+    {
+        blecm_SetPtrConMux(p_peer->con_handle);
+        bleprofile_sendWriteCmd(p_peer->config_handle, e->data, e->len);
+    }
+    else
+    {
+        if (p_peer->write_outstanding)
+        {
+            return FALSE;
+        }
+        blecm_SetPtrConMux(p_peer->con_handle);
+        p_peer->write_outstanding = TRUE;
+        p_peer->write_start       = hello_client.app_timer_count;
+        bleprofile_sendWriteReq(p_peer->config_handle, e->data, e->len);
+    }
+    return TRUE;
+}
+
+//
+// Send queued commands to the sensors.  Command is removed from the queue when
+// it has been sent to all its sensors, next command waits for that to keep the
+// order.  Connection mux context of the caller is restored at the end.
+//
+void hello_client_cmd_drain(void)
+{
+    UINT16 con_handle = emconinfo_getConnHandle();
+    int    i;
+
+    while (hello_client.cmd_count != 0)
+    {
+        HELLO_CLIENT_CMD_ENTRY *e = &hello_client.cmd_queue[hello_client.cmd_head];
+
+        for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+        {
+            if ((e->pending & (1 << i)) && hello_client_cmd_send(&hello_client.link[i].peer, e))
+            {
+                e->pending &= ~(1 << i);
+            }
+        }
+
+        if (e->pending != 0)
+        {
+            break;
+        }
+
+        hello_client.cmd_head = (hello_client.cmd_head + 1) % HELLO_CLIENT_CMD_QUEUE_DEPTH;
+        hello_client.cmd_count--;
+    }
+
+    if (emconinfo_getConnHandle() != con_handle)
+    {
+        blecm_SetPtrConMux(con_handle);
+    }
 }
 
-void hello_client_process_write_rsp(void)
+//
+// Sensor link is down, commands do not wait for it anymore
+//
+void hello_client_cmd_cancel(int cm_index)
 {
-    ble_trace0("Client write rsp\n");
+    int i;
+
+    for (i = 0; i < hello_client.cmd_count; i++)
+    {
+        hello_client.cmd_queue[(hello_client.cmd_head + i) % HELLO_CLIENT_CMD_QUEUE_DEPTH].pending &= ~(1 << cm_index);
+    }
 }
 
-void hello_client_process_data_from_peripheral(int len, UINT8 *data)
+#ifdef HELLO_CLIENT_BENCH
+//
+// Return number of the sensors which can run the benchmark
+//
+int hello_client_bench_sensors(void)
+{
+    int num = 0;
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_MAX_PERIPHERALS; i++)
+    {
+        if ((hello_client.link[i].stats.role == CENTRAL_ROLE) &&
+            (hello_client.link[i].peer.disc_state == HELLO_CLIENT_DISC_DONE))
+        {
+            num++;
+        }
+    }
+    return num;
+}
+
+//
+// Write the rate to the traffic generators of the first num_sensors sensors
+//
+void hello_client_bench_set_rate(int num_sensors, UINT8 rate)
 {
-    // if central allows notifications, forward received data
-    // Because we will be sending on the different connection, change Set Pointer to the central context
-    if ((hello_client.hostinfo.characteristic_client_configuration & CCC_NOTIFICATION) != 0)
+    UINT8 cmd[2] = {HELLO_SENSOR_BENCH_CMD, rate};
+    int   i;
+
+    for (i = 0; (i < HELLO_CLIENT_MAX_PERIPHERALS) && (num_sensors > 0); i++)
     {
-        blecm_SetPtrConMux(hello_client.handle_to_central);
-        bleprofile_sendNotification(HANDLE_HELLO_CLIENT_DATA_VALUE, data, len < 20 ? len : 20);
+        if ((hello_client.link[i].stats.role == CENTRAL_ROLE) &&
+            (hello_client.link[i].peer.disc_state == HELLO_CLIENT_DISC_DONE))
+        {
+            hello_client_cmd_enqueue(i, cmd, sizeof(cmd));
+            num_sensors--;
+        }
     }
-    else if ((hello_client.hostinfo.characteristic_client_configuration & CCC_INDICATION) != 0)
+}
+
+void hello_client_bench_step_start(UINT32 count)
+{
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+
+    p->step_start     = count;
+    p->frames         = 0;
+    p->bytes          = 0;
+    p->seq_drops      = 0;
+    p->overflow_drops = hello_client.relay_overflow_drops;
+    p->reconnects     = 0;
+    p->reconnect_max  = 0;
+    memset(p->dwell, 0, sizeof(p->dwell));
+
+    hello_client_bench_set_rate(p->num_sensors, hello_client_bench_rate[p->rate_index]);
+}
+
+//
+// Return upper bound in ms of the dwell time bucket which holds the percentile of the frames
+//
+UINT32 hello_client_bench_percentile(int percent)
+{
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+    UINT32 rank = (p->frames * percent + 99) / 100;
+    UINT32 sum  = 0;
+    int    i;
+
+    for (i = 0; i < HELLO_CLIENT_BENCH_BUCKETS - 1; i++)
     {
-        blecm_SetPtrConMux(hello_client.handle_to_central);
-        bleprofile_sendIndication(HANDLE_HELLO_CLIENT_DATA_VALUE, data, len < 20 ? len : 20, NULL);
+        sum += p->dwell[i];
+        if (sum >= rank)
+        {
+            break;
+        }
     }
+    return 1UL << i;
 }
 
-void hello_client_notification_handler(int len, int attr_len, UINT8 *data)
+void hello_client_bench_report(void)
 {
-    ble_trace2("Notification:%02x, %d\n", (UINT16)attr_len, len);
-    ble_tracen((char *)data, len);
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
 
-    hello_client_process_data_from_peripheral(len, data);
+    ble_trace4("bench sensors:%d rate:%d frames:%d B/s:%d\n", p->num_sensors,
+               hello_client_bench_rate[p->rate_index], p->frames, p->bytes / HELLO_CLIENT_BENCH_STEP_TIME);
+    ble_trace4("bench dwell p50:<%dms p99:<%dms drops:%d overflow:%d\n", hello_client_bench_percentile(50),
+               hello_client_bench_percentile(99), p->seq_drops, hello_client.relay_overflow_drops - p->overflow_drops);
+    ble_trace2("bench reconnects:%d max:%dms\n", p->reconnects, p->reconnect_max);
 }
 
-void hello_client_indication_handler(int len, int attr_len, UINT8 *data)
+//
+// Run the benchmark steps.  Benchmark starts when a central and a sensor are
+// connected for a while and ends when it runs out of the sensors.
+//
+void hello_client_bench_timeout(UINT32 count)
 {
-    ble_trace2("Indication:%02x, %d\n", (UINT16)attr_len, len);
-    ble_tracen((char *)data, len);
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+    UINT8 stop[2]         = {HELLO_SENSOR_BENCH_CMD, 0};
 
-    hello_client_process_data_from_peripheral(len, data);
+    switch (p->state)
+    {
+    case HELLO_CLIENT_BENCH_IDLE:
+        if ((hello_client.num_centrals == 0) || (hello_client_bench_sensors() == 0))
+        {
+            p->step_start = count;
+        }
+        else if (count - p->step_start >= HELLO_CLIENT_BENCH_START_DELAY)
+        {
+            hello_client_cmd_enqueue(HELLO_CLIENT_CMD_TARGET_ALL, stop, sizeof(stop));
 
-    bleprofile_sendHandleValueConf();
+            p->state       = HELLO_CLIENT_BENCH_RUNNING;
+            p->num_sensors = 1;
+            p->rate_index  = 0;
+            hello_client_bench_step_start(count);
+        }
+        break;
+
+    case HELLO_CLIENT_BENCH_RUNNING:
+        if (count - p->step_start < HELLO_CLIENT_BENCH_STEP_TIME)
+        {
+            break;
+        }
+        hello_client_bench_report();
+
+        if (++p->rate_index == HELLO_CLIENT_BENCH_NUM_RATES)
+        {
+            p->rate_index = 0;
+            p->num_sensors++;
+        }
+        if (p->num_sensors > hello_client_bench_sensors())
+        {
+            hello_client_cmd_enqueue(HELLO_CLIENT_CMD_TARGET_ALL, stop, sizeof(stop));
+
+            p->state = HELLO_CLIENT_BENCH_DONE;
+            ble_trace0("bench done\n");
+            break;
+        }
+        hello_client_bench_step_start(count);
+        break;
+    }
 }
 
 //
-// Process write request or command from peer device
+// Check the sequence number of a benchmark frame received from a sensor
 //
-int hello_client_write_handler(LEGATTDB_ENTRY_HDR *p)
+void hello_client_bench_receive(int cm_index, UINT8 *data, int len)
 {
-    UINT8  writtenbyte;
-    UINT16 handle   = legattdb_getHandle(p);
-    int    len      = legattdb_getAttrValueLen(p);
-    UINT8  *attrPtr = legattdb_getAttrValue(p);
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+    UINT16 seq;
+    UINT16 gap;
+
+    if ((p->state != HELLO_CLIENT_BENCH_RUNNING) || (len < HELLO_SENSOR_BENCH_HDR_LEN) ||
+        (data[0] != HELLO_SENSOR_BENCH_MARKER))
+    {
+        return;
+    }
+
+    seq = data[HELLO_SENSOR_BENCH_SEQ_OFFSET] | (data[HELLO_SENSOR_BENCH_SEQ_OFFSET + 1] << 8);
+    if (p->seq_valid & (1 << cm_index))
+    {
+        gap = seq - p->seq_next[cm_index];
+
+        // duplicate or late frame is not a drop, and does not move the expected number back
+        if (gap >= 0x8000)
+        {
+            return;
+        }
+        p->seq_drops += gap;
+    }
+    p->seq_next[cm_index] = seq + 1;
+    p->seq_valid         |= 1 << cm_index;
+}
+
+//
+// Count benchmark frame sent to the central and its dwell time in the client
+//
+void hello_client_bench_relayed(UINT8 *data, int len, UINT32 arrival)
+{
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+    UINT32 ms             = (HELLO_CLIENT_CYCLES() - arrival) / HELLO_CLIENT_BENCH_CYCLES_PER_MS;
+    int    bucket         = 0;
+
+    if ((p->state != HELLO_CLIENT_BENCH_RUNNING) || (len < HELLO_SENSOR_BENCH_HDR_LEN) ||
+        (data[0] != HELLO_SENSOR_BENCH_MARKER))
+    {
+        return;
+    }
+
+    while ((bucket < HELLO_CLIENT_BENCH_BUCKETS - 1) && (ms >= (1UL << bucket)))
+    {
+        bucket++;
+    }
+    p->dwell[bucket]++;
+    p->frames++;
+    p->bytes += len;
+}
+
+//
+// Sensor generator stops with the connection, the time to the next sensor
+// link up is counted as the reconnect time
+//
+void hello_client_bench_link_down(int cm_index)
+{
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+
+    p->seq_valid &= ~(1 << cm_index);
+    if (!p->link_down)
+    {
+        p->link_down      = TRUE;
+        p->link_down_time = hello_client.app_fine_timer_count;
+    }
+}
+
+void hello_client_bench_link_up(void)
+{
+    HELLO_CLIENT_BENCH_STATE *p = &hello_client.bench;
+    UINT32 ms;
+
+    if (p->link_down)
+    {
+        ms = (hello_client.app_fine_timer_count - p->link_down_time) * HELLO_CLIENT_FINE_TIMER_INTERVAL;
+        if (ms > p->reconnect_max)
+        {
+            p->reconnect_max = ms;
+        }
+        p->reconnects++;
+        p->link_down = FALSE;
+    }
+}
+#endif
+
+#ifdef HELLO_CLIENT_PROFILE
+//
+// Save time spent in the callback since the start cycle count
+//
+void hello_client_profile_record(UINT8 id, UINT32 start)
+{
+    HELLO_CLIENT_PROFILE_ENTRY *p = &hello_client.profile[id];
+    UINT32 cycles = HELLO_CLIENT_CYCLES() - start;
+
+    if ((p->count == 0) || (cycles < p->min))
+    {
+        p->min = cycles;
+    }
+    if (cycles > p->max)
+    {
+        p->max = cycles;
+    }
+
+    // keep the average when the sum is about to overflow
+    if (p->sum + cycles < p->sum)
+    {
+        p->sum   >>= 1;
+        p->count >>= 1;
+    }
+    p->sum += cycles;
+    p->count++;
+}
+
+//
+// Put counters of the selected callback into the statistics characteristic
+//
+void hello_client_profile_update(void)
+{
+    UINT8                        id = hello_client.stats_index - HELLO_CLIENT_PROFILE_SELECT;
+    HELLO_CLIENT_PROFILE_ENTRY  *p  = &hello_client.profile[id];
+    HELLO_CLIENT_PROFILE_RECORD *p_record;
+    BLEPROFILE_DB_PDU            db_pdu;
+
+    p_record = (HELLO_CLIENT_PROFILE_RECORD *)db_pdu.pdu;
+    p_record->index = hello_client.stats_index;
+    p_record->count = p->count;
+    p_record->min   = p->min;
+    p_record->avg   = (p->count != 0) ? (p->sum / p->count) : 0;
+    p_record->max   = p->max;
+
+    db_pdu.len = sizeof(HELLO_CLIENT_PROFILE_RECORD);
+    bleprofile_WriteHandle(HANDLE_HELLO_CLIENT_STATS_VALUE, &db_pdu);
+}
+
+//
+// Print counters of all callbacks to the PUART
+//
+void hello_client_profile_dump(void)
+{
+    int i;
+
+    for (i = 0; i < HELLO_CLIENT_PROFILE_NUM; i++)
+    {
+        HELLO_CLIENT_PROFILE_ENTRY *p = &hello_client.profile[i];
+
+        ble_trace4("profile %d count:%d min:%d max:%d\n", i, p->count, p->min, p->max);
+        ble_trace2("profile %d avg:%d\n", i, (p->count != 0) ? (p->sum / p->count) : 0);
+    }
+}
+
+// Callbacks registered with the stack when profiling is enabled
+void hello_client_connection_up_profiled(void)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_connection_up();
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_CONN_UP, start);
+}
+
+void hello_client_connection_down_profiled(void)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_connection_down();
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_CONN_DOWN, start);
+}
+
+void hello_client_notification_handler_profiled(int len, int attr_len, UINT8 *data)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_notification_handler(len, attr_len, data);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_NOTIFICATION, start);
+}
+
+void hello_client_indication_handler_profiled(int len, int attr_len, UINT8 *data)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_indication_handler(len, attr_len, data);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_INDICATION, start);
+}
+
+void hello_client_advertisement_report_profiled(HCIULP_ADV_PACKET_REPORT_WDATA *evt)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_advertisement_report(evt);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_ADV_REPORT, start);
+}
+
+int hello_client_write_handler_profiled(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+    int    status;
+
+    status = hello_client_write_handler(p);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_WRITE, start);
+    return status;
+}
+
+void hello_client_app_timer_profiled(UINT32 arg)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_app_timer(arg);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_APP_TIMER, start);
+}
+
+void hello_client_app_fine_timer_profiled(UINT32 arg)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_app_fine_timer(arg);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_FINE_TIMER, start);
+}
+
+void hello_client_timer_callback_profiled(UINT32 arg)
+{
+    UINT32 start = HELLO_CLIENT_CYCLES();
+
+    hello_client_timer_callback(arg);
+    hello_client_profile_record(HELLO_CLIENT_PROFILE_TIMER_CALLBACK, start);
+}
+#endif
+
+//
+// By writing into Characteristic Client Configuration descriptor
+// peer can enable or disable notification or indication
+//
+int hello_client_write_client_configuration(UINT8 *attrPtr, int len)
+{
+    HELLO_CLIENT_CENTRAL *p_central = hello_client_central_find(emconinfo_getConnHandle());
+
+    if ((len == 2) && (p_central != NULL))
+    {
+        UINT16 client_configuration = attrPtr[0] + (attrPtr[1] << 8);
+
+        HELLO_CLIENT_TRACE1("hello_client_write_handler: client_configuration %04x\n", client_configuration);
+
+        // Save update to NVRAM later, so that central toggling the descriptor does not
+        // write the NVRAM every time.  Client does not need to set it on every connection.
+        if (client_configuration != p_central->hostinfo.characteristic_client_configuration)
+        {
+            p_central->hostinfo.characteristic_client_configuration = client_configuration;
+            hello_client_hostinfo_changed(p_central);
+        }
+
+        // send out data collected while central was not registered
+        hello_client_relay_drain();
+        return 0;
+    }
+    return 0x80;
+}
 
-    ble_trace1("hello_client_write_handler: handle %04x\n", handle);
+//
+// Central writes commands for the sensors to the data characteristic
+//
+int hello_client_write_data(UINT8 *attrPtr, int len)
+{
+    HELLO_CLIENT_TRACEN(attrPtr, len);
+
+    // forward command to the sensors, first byte is the target
+    if ((len == 3) && (attrPtr[0] == HELLO_CLIENT_CMD_TARGET_PRIORITY))
+    {
+        hello_client_set_priority(attrPtr[1], attrPtr[2]);
+    }
+    else if (len >= 2)
+    {
+        hello_client_cmd_enqueue(attrPtr[0], &attrPtr[1], len - 1);
+        hello_client_cmd_drain();
+    }
+    return 0;
+}
 
-    // By writing into Characteristic Client Configuration descriptor
-    // peer can enable or disable notification or indication
-    if ((len == 2) && (handle == HANDLE_HELLO_CLIENT_CLIENT_CONFIGURATION_DESCRIPTOR))
+//
+// Peer writes connection mux index to select counters in the statistics characteristic
+//
+int hello_client_write_stats(UINT8 *attrPtr, int len)
+{
+    if ((len == 1) && (attrPtr[0] < HELLO_CLIENT_MAX_PERIPHERALS))
+    {
+        hello_client.stats_index = attrPtr[0];
+        hello_client_stats_update();
+        return 0;
+    }
+#ifdef HELLO_CLIENT_PROFILE
+    if ((len == 1) && (attrPtr[0] >= HELLO_CLIENT_PROFILE_SELECT) && (attrPtr[0] < HELLO_CLIENT_PROFILE_SELECT + HELLO_CLIENT_PROFILE_NUM))
     {
-        hello_client.hostinfo.characteristic_client_configuration = attrPtr[0] + (attrPtr[1] << 8);
-        ble_trace1("hello_client_write_handler: client_configuration %04x\n", hello_client.hostinfo.characteristic_client_configuration);
+        hello_client.stats_index = attrPtr[0];
+        hello_client_profile_update();
+        hello_client_profile_dump();
+        return 0;
+    }
+#endif
+    return 0x80;
+}
+
+//
+// Peer writes new configuration, or a single 0 byte to restore the configuration
+// of the build.  Configuration is applied and saved right away, peer tunes it
+// only once in a while.
+//
+int hello_client_write_config(UINT8 *attrPtr, int len)
+{
+    HELLO_CLIENT_CONFIG_RECORD *p_record = (HELLO_CLIENT_CONFIG_RECORD *)attrPtr;
+    UINT8 writtenbyte;
 
-        // Save update to NVRAM.  Client does not need to set it on every connection.
-        writtenbyte = bleprofile_WriteNVRAM(NVRAM_ID_HOST_LIST, sizeof(hello_client.hostinfo), (UINT8 *)&hello_client.hostinfo);
-        ble_trace1("hello_client_write_handler: NVRAM write:%04x\n", writtenbyte);
+    if ((len == 1) && (attrPtr[0] == 0))
+    {
+        hello_client.config = hello_client.config_default;
+        bleprofile_DeleteNVRAM(NVRAM_ID_CONFIG);
     }
-    else if (handle == HANDLE_HELLO_CLIENT_DATA_VALUE)
+    else if ((len == sizeof(HELLO_CLIENT_CONFIG_RECORD)) && hello_client_config_valid(p_record))
     {
-        ble_tracen((char *)attrPtr, len);
+        memcpy(&hello_client.config, p_record, sizeof(HELLO_CLIENT_CONFIG_RECORD));
+        writtenbyte = bleprofile_WriteNVRAM(NVRAM_ID_CONFIG, sizeof(HELLO_CLIENT_CONFIG_RECORD), (UINT8 *)&hello_client.config);
+        ble_trace1("config NVRAM write:%04x\n", writtenbyte);
     }
     else
     {
-        ble_trace2("hello_sensor_write_handler: bad write len:%d handle:0x%x\n", len, handle);
+        // value in the database has to show the configuration in use
+        hello_client_config_update();
         return 0x80;
     }
 
+    hello_client_config_apply();
     return 0;
 }
 
+// write handlers indexed by the handle offset from the Hello Client service,
+// attributes which are not listed cannot be written
+#define HELLO_CLIENT_WRITE_DISPATCH(name)   [HANDLE_HELLO_CLIENT_##name - HANDLE_HELLO_CLIENT_SERVICE_UUID]
+
+int (* const hello_client_write_dispatch[])(UINT8 *attrPtr, int len) =
+{
+    HELLO_CLIENT_WRITE_DISPATCH(DATA_VALUE)                      = hello_client_write_data,
+    HELLO_CLIENT_WRITE_DISPATCH(CLIENT_CONFIGURATION_DESCRIPTOR) = hello_client_write_client_configuration,
+    HELLO_CLIENT_WRITE_DISPATCH(STATS_VALUE)                     = hello_client_write_stats,
+    HELLO_CLIENT_WRITE_DISPATCH(CONFIG_VALUE)                    = hello_client_write_config,
+};
+
+#define HELLO_CLIENT_WRITE_DISPATCH_SIZE    (sizeof(hello_client_write_dispatch) / sizeof(hello_client_write_dispatch[0]))
+
+//
+// Process write request or command from peer device
+//
+int hello_client_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16 handle   = legattdb_getHandle(p);
+    int    len      = legattdb_getAttrValueLen(p);
+    UINT8  *attrPtr = legattdb_getAttrValue(p);
+    UINT16 index    = handle - HANDLE_HELLO_CLIENT_SERVICE_UUID;
+    int    status   = 0x80;
+
+    HELLO_CLIENT_TRACE1("hello_client_write_handler: handle %04x\n", handle);
+
+    // handles below the service wrap around to a large index
+    if ((index < HELLO_CLIENT_WRITE_DISPATCH_SIZE) && (hello_client_write_dispatch[index] != NULL))
+    {
+        status = hello_client_write_dispatch[index](attrPtr, len);
+    }
+
+    if (status != 0)
+    {
+        HELLO_CLIENT_TRACE2("hello_client_write_handler: bad write len:%d handle:0x%x\n", len, handle);
+    }
+    return status;
+}
+
 UINT32 hello_client_interrupt_handler(UINT32 value)
 {
-    BLEPROFILE_DB_PDU db_pdu;
+    static char *buf = "From Client\n";
     BOOL   button_pushed = value & 0x01;
-    static UINT32 button_pushed_time = 0;
+    int    i;
 
     ble_trace3("(INT)But1:%d But2:%d But3:%d\n", value&0x01, (value& 0x02) >> 1, (value & 0x04) >> 2);
-    if (button_pushed)
+
+    // sensors are looked for from the power up, button restarts the search with the high duty
+    // cycle if it backed off and stopped the timers, and sends a test notification
+    if (!button_pushed)
+    {
+        return 0;
+    }
+
+    if (hello_client.timers_stopped)
     {
-        button_pushed_time = hello_client.app_timer_count;
+        hello_client_timers_start();
+        hello_client_state_event(HELLO_CLIENT_EVENT_START);
     }
-    else if (button_pushed_time != 0)
+
+    for (i = 0; i < HELLO_CLIENT_MAX_CENTRALS; i++)
     {
-        if (hello_client.app_timer_count - button_pushed_time > 5)
-        {
-            ble_trace0("Stop adverts and start high scan\n");
-            bleprofile_Discoverable(NO_DISCOVERABLE, NULL);
-            blecen_Scan(HIGH_SCAN);
-        }
-        else
+        if (hello_client.central[i].con_handle != 0)
         {
-            if (hello_client.handle_to_central != 0)
-            {
-                static char *buf = "From Client\n";
-                blecm_SetPtrConMux(hello_client.handle_to_central);
-                bleprofile_sendNotification(HANDLE_HELLO_CLIENT_DATA_VALUE, (UINT8 *)buf, 12);
-            }
+            blecm_SetPtrConMux(hello_client.central[i].con_handle);
+            bleprofile_sendNotification(HANDLE_HELLO_CLIENT_DATA_VALUE, (UINT8 *)buf, 12);
         }
     }
     return 0;
@@ -42,10 +42,24 @@
 #ifndef HELLO_CLIENT_H
 #define HELLO_CLIENT_H
 
+// Attributes of the Hello Client service are listed once, the handles used in the
+// GATT database are generated from the list.
+#define HELLO_CLIENT_ATTRIBUTES(ATTR) \
+    ATTR(SERVICE_UUID,                    0x28) \
+    ATTR(DATA,                            0x29) \
+    ATTR(DATA_VALUE,                      0x2a) \
+    ATTR(CLIENT_CONFIGURATION_DESCRIPTOR, 0x2b) \
+    ATTR(STATS,                           0x2c) \
+    ATTR(STATS_VALUE,                     0x2d) \
+    ATTR(CONFIG,                          0x2e) \
+    ATTR(CONFIG_VALUE,                    0x2f)
+
 // following definitions for handles used in the GATT database
-#define HANDLE_HELLO_CLIENT_SERVICE_UUID                    0x28
-#define HANDLE_HELLO_CLIENT_DATA_VALUE                      0x2a
-#define HANDLE_HELLO_CLIENT_CLIENT_CONFIGURATION_DESCRIPTOR 0x2b
+#define HELLO_CLIENT_HANDLE(name, handle)                   HANDLE_HELLO_CLIENT_##name = handle,
+enum
+{
+    HELLO_CLIENT_ATTRIBUTES(HELLO_CLIENT_HANDLE)
+};
 
 
 // Please note that all UUIDs need to be reversed when publishing in the database
@@ -57,4 +71,12 @@
 // static const GUID UUID_HELLO_CLIENT_DATA = { 0xb77acfa5, 0x8f26, 0x4af6, { 0x81, 0x5b, 0x74, 0xd0, 0x3b, 0x45, 0x42, 0xc5 } };
 #define UUID_HELLO_CLIENT_DATA                0xc5, 0x42, 0x45, 0x3b, 0xd0, 0x74, 0x5b, 0x81, 0xf6, 0x4a, 0x26, 0x8f, 0xa5, 0xcf, 0x7a, 0xb7
 
+// {1B6405F1-4428-4BF0-8D17-D42AABB05308}
+// static const GUID UUID_HELLO_CLIENT_STATS = { 0x1b6405f1, 0x4428, 0x4bf0, { 0x8d, 0x17, 0xd4, 0x2a, 0xab, 0xb0, 0x53, 0x8 } };
+#define UUID_HELLO_CLIENT_STATS               0x08, 0x53, 0xb0, 0xab, 0x2a, 0xd4, 0x17, 0x8d, 0xf0, 0x4b, 0x28, 0x44, 0xf1, 0x05, 0x64, 0x1b
+
+// {4363753E-C1A6-4DBD-9BA3-8A8F81271CA0}
+// static const GUID UUID_HELLO_CLIENT_CONFIG = { 0x4363753e, 0xc1a6, 0x4dbd, { 0x9b, 0xa3, 0x8a, 0x8f, 0x81, 0x27, 0x1c, 0xa0 } };
+#define UUID_HELLO_CLIENT_CONFIG              0xa0, 0x1c, 0x27, 0x81, 0x8f, 0x8a, 0xa3, 0x9b, 0xbd, 0x4d, 0xa6, 0xc1, 0x3e, 0x75, 0x63, 0x43
+
 #endif
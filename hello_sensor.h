@@ -43,12 +43,39 @@
 #define HELLO_SENSOR_H
 
 // following definitions are shared between client and sensor
-// to avoid unnecessary GATT Discovery
+// to avoid unnecessary GATT Discovery.  Attributes of the Hello
+// Sensor service are listed once, the handles are generated from it.
 //
-#define HANDLE_HELLO_SENSOR_SERVICE_UUID                    0x28
-#define HANDLE_HELLO_SENSOR_VALUE_NOTIFY                    0x2a
-#define HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR 0x2b
-#define HANDLE_HELLO_SENSOR_CONFIGURATION                   0x2d
+#define HELLO_SENSOR_ATTRIBUTES(ATTR) \
+    ATTR(SERVICE_UUID,                    0x28) \
+    ATTR(VALUE_NOTIFY,                    0x2a) \
+    ATTR(CLIENT_CONFIGURATION_DESCRIPTOR, 0x2b) \
+    ATTR(CONFIGURATION,                   0x2d)
+
+#define HELLO_SENSOR_HANDLE(name, handle)                   HANDLE_HELLO_SENSOR_##name = handle,
+enum
+{
+    HELLO_SENSOR_ATTRIBUTES(HELLO_SENSOR_HANDLE)
+};
+
+// Sensor records larger than one notification are sent as segments.  First byte of each
+// segment is the segmentation header, first and last flags and the sequence number which
+// starts at 0 and wraps at 64.  Record which fits one notification has both flags set.
+#define HELLO_SENSOR_SEG_FIRST                              0x80
+#define HELLO_SENSOR_SEG_LAST                               0x40
+#define HELLO_SENSOR_SEG_SEQ_MASK                           0x3f
+
+// Benchmark traffic generator of the sensor.  Client writes HELLO_SENSOR_BENCH_CMD followed
+// by the rate in notifications per second to the configuration characteristic, rate 0 or the
+// end of the connection stops the generator.  Each frame fills a notification, the marker,
+// the sequence number from 0 (2 bytes) and the sensor timestamp in ms (4 bytes), little
+// endian, followed by padding.  Client checks the sequence numbers, the timestamp is relayed
+// as is for the central.  Marker has both segmentation flags set, so a frame is relayed as a
+// record which fits one notification.
+#define HELLO_SENSOR_BENCH_CMD                              0xb5
+#define HELLO_SENSOR_BENCH_MARKER                           0xf5
+#define HELLO_SENSOR_BENCH_SEQ_OFFSET                       1
+#define HELLO_SENSOR_BENCH_HDR_LEN                          7
 
 // Please note that all UUIDs need to be reversed when publishing in the database
 
@@ -0,0 +1,1493 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+*
+* Host harness of the Hello Client
+*
+* The application is compiled for the host with the shim of the ROM SDK in
+* include/, and runs against a simulated stack.  Simulated Hello Sensors and
+* centrals connect, the sensors send notifications or indications at the
+* rate given on the command line, other devices advertise while the client
+* scans, and the centrals write commands for the sensors.  Time advances in
+* 1 ms steps.  Every link has a connection event once per connection
+* interval.  TX buffers are one pool, released a few packets per connection
+* event.  The central confirms an indication and the sensor responds to a
+* write in the next event.
+*
+* At the end the harness prints the cost of each application callback,
+* taken from the host time stamp counter.  It also prints the relay queue
+* depths and the data and commands dropped on the way.  Cost on the host can
+* only be compared between runs on the same machine.  It is meant to catch
+* regressions before the code goes to the board.
+*
+* Build and run from the application directory:
+*   gcc -O2 -Wall -Ihost/include -o hello_client_host host/hello_client_host.c
+*   ./hello_client_host -s 4 -c 1 -r 20 -t 60
+*
+*/
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../hello_client.c"
+
+/******************************************************
+ *                      Constants
+ ******************************************************/
+#define HOST_MAX_LINKS                  8       // links the simulated controller can hold
+#define HOST_MAX_SENSORS                HELLO_CLIENT_MAX_SENSORS
+#define HOST_MAX_CENTRALS               4
+#define HOST_MAX_ADVERTISERS            64
+#define HOST_NVRAM_IDS                  0x20
+#define HOST_NVRAM_MAX_LEN              64
+#define HOST_PACKETS_PER_EVENT          4       // packets each side sends in a connection event
+#define HOST_SENSOR_ADV_INTERVAL        100     // ms
+#define HOST_SENSOR_BACKLOG             16      // frames the sensor keeps while it cannot send
+#define HOST_SENSOR_OFFLINE_TIME        2000    // ms sensor does not advertise after its link drops
+#define HOST_CENTRAL_RECONNECT_TIME     1000    // ms before a rejected central tries again
+#define HOST_CENTRAL_ADV_CHANCE         20      // central connects in one of this many ms while client advertises
+#define HOST_CONN_TIMEOUT               3       // seconds before the connection attempt times out
+#define HOST_ATT_TIMEOUT                30000   // ms sensor waits for the indication confirmation
+
+// Hello Sensor GATT database known to the simulated sensors
+#define HOST_SENSOR_SERVICE_END         0x2d
+#define HOST_SENSOR_DATA_DECLARATION    0x29
+#define HOST_SENSOR_CONFIG_DECLARATION  0x2c
+
+// events which cost is measured
+#define HOST_EVENT_CONN_UP              0
+#define HOST_EVENT_CONN_DOWN            1
+#define HOST_EVENT_NOTIFICATION         2
+#define HOST_EVENT_INDICATION           3
+#define HOST_EVENT_ADV_REPORT           4
+#define HOST_EVENT_WRITE                5
+#define HOST_EVENT_ATT_RSP              6
+#define HOST_EVENT_ENCRYPTION           7
+#define HOST_EVENT_INDICATION_CFM       8
+#define HOST_EVENT_FINE_TIMER           9
+#define HOST_EVENT_APP_TIMER            10
+#define HOST_EVENT_TIMER_CALLBACK       11
+#define HOST_EVENT_NUM                  12
+
+// advertising report event types
+#define HOST_ADV_IND                    0x00
+#define HOST_SCAN_RSP                   0x04
+
+// ATT requests from the client waiting for the sensor to respond
+#define HOST_RSP_NONE                   0
+#define HOST_RSP_GROUP_TYPE             1
+#define HOST_RSP_TYPE                   2
+
+/******************************************************
+ *                     Structures
+ ******************************************************/
+// link of the simulated controller
+typedef struct
+{
+    BOOL              up;
+    UINT16            con_handle;
+    UINT8             role;             // CENTRAL_ROLE for a sensor link, PERIPHERAL_ROLE for a central link
+    int               peer;             // index of the sensor or of the central
+    EMCONINFO_DEVINFO dev_info;
+    LESMP_INFO        smp_info;
+    UINT16            phase;            // ms of the connection event in the connection interval
+    int               tx_queued;        // packets sent by the client waiting for the connection event
+    BOOL              encrypt_pending;  // encryption completes in the next connection event
+    BOOL              down_pending;     // client disconnected, link goes down in the next step
+    int               write_rsp_due;    // write responses the sensor sends in the next connection event
+    void            (*indication_cfm)(void);    // callback of the indication sent to the central
+    BOOL              indication_due;   // central confirms the indication in the next connection event
+    UINT8             rsp_type;         // one of the HOST_RSP_ types
+    UINT16            rsp_start;
+    UINT16            rsp_uuid;
+    BOOL              conf_due;         // client confirmed the indication of the sensor
+} HOST_LINK;
+
+typedef struct
+{
+    BD_ADDR bdaddr;
+    int     link;                       // link to the client, -1 if not connected
+    UINT32  online_time;                // ms when the sensor advertises again
+    UINT16  adv_phase;
+    BOOL    subscribed;                 // client enabled the notifications
+    UINT32  credit;                     // frames generated, times 1000
+    int     backlog;                    // frames waiting to be sent
+    int     segments_left;              // segments of the record being sent
+    UINT8   seg_seq;
+    BOOL    confirm_wait;               // indication sent, confirmation not received yet
+    UINT32  confirm_wait_start;
+    UINT32  frames_sent;
+    UINT32  frames_lost;                // frames which did not fit the backlog of the sensor
+    UINT32  commands;                   // commands written by the client
+    UINT32  confirm_wait_max;           // ms
+    UINT32  att_timeouts;
+    UINT32  connects;
+} HOST_SENSOR;
+
+typedef struct
+{
+    BD_ADDR bdaddr;
+    int     link;                       // link to the client, -1 if not connected
+    BOOL    waiting;                    // looking for the client
+    UINT32  want_time;                  // ms when the central starts to look for the client
+    BOOL    encrypted;
+    BOOL    subscribed;
+    UINT32  cmd_credit;                 // commands generated, times 1000
+    UINT32  commands;                   // commands written to the client
+    UINT32  frames;                     // notifications and indications received
+    UINT32  bytes;
+    UINT32  connect_wait_max;           // ms
+    UINT32  connects;
+} HOST_CENTRAL;
+
+// cost of the application callback
+typedef struct
+{
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long max;
+} HOST_COST;
+
+typedef struct
+{
+    UINT8   len;                        // 0 if nothing is saved
+    UINT8   data[HOST_NVRAM_MAX_LEN];
+} HOST_NVRAM;
+
+// registered callbacks of the application
+typedef struct
+{
+    void   (*create)(void);
+    void   (*conn_up)(void);
+    void   (*conn_down)(void);
+    BLECM_FUNC_WITH_PARAM adv_report;
+    LEATT_TRIPLE_PARAM_CB notification;
+    LEATT_TRIPLE_PARAM_CB indication;
+    LEATT_TRIPLE_PARAM_CB read_rsp;
+    LEATT_TRIPLE_PARAM_CB read_by_type_rsp;
+    LEATT_TRIPLE_PARAM_CB read_by_group_type_rsp;
+    LEATT_NO_PARAM_CB     write_rsp;
+    LEGATTDB_WRITE_CB     write;
+    void   (*encryption_changed)(HCI_EVT_HDR *evt);
+    LESMP_SINGLE_PARAM_CB smp_result;
+    UINT32 (*interrupt)(UINT32 value);
+    BLEAPP_TIMER_CB       fine_timer;
+    BLEAPP_TIMER_CB       app_timer;
+    UINT32 (*lpm_query)(LowPowerModePollType type, UINT32 context);
+} HOST_CALLBACKS;
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+// variables of the ROM
+BLE_CEN_CFG blecen_cen_cfg =
+{
+    /*.scan_type                =*/ HCIULP_ACTIVE_SCAN,
+    /*.scan_adr_type            =*/ HCIULP_PUBLIC_ADDRESS,
+    /*.scan_filter_policy       =*/ HCIULP_SCAN_FILTER_POLICY_ACCEPT_LIST_NOT_USED,
+    /*.filter_duplicates        =*/ HCIULP_SCAN_DUPLICATE_FILTER_ON,
+    /*.init_filter_policy       =*/ HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_NOT_USED,
+    /*.init_addr_type           =*/ HCIULP_PUBLIC_ADDRESS,
+    /*.high_scan_interval       =*/ 96,
+    /*.low_scan_interval        =*/ 2048,
+    /*.high_scan_window         =*/ 48,
+    /*.low_scan_window          =*/ 18,
+    /*.high_scan_duration       =*/ 30,
+    /*.low_scan_duration        =*/ 300,
+    /*.high_conn_min_interval   =*/ 40,
+    /*.low_conn_min_interval    =*/ 400,
+    /*.high_conn_max_interval   =*/ 56,
+    /*.low_conn_max_interval    =*/ 560,
+    /*.high_conn_latency        =*/ 0,
+    /*.low_conn_latency         =*/ 0,
+    /*.high_supervision_timeout =*/ 10,
+    /*.low_supervision_timeout  =*/ 100,
+    /*.conn_min_event_len       =*/ 0,
+    /*.conn_max_event_len       =*/ 0,
+};
+BLEAPP_TIMER_CB       blecen_usertimerCb;
+BLE_PROFILE_CFG      *bleprofile_p_cfg;
+BLE_PROFILE_GPIO_CFG *bleprofile_gpio_p_cfg;
+LESMP_INFO           *lesmp_pinfo;
+LESMPAPI_API         *lesmpapi_msgHandlerPtr;
+UINT32                blecm_configFlag;
+
+// command line options
+int    host_duration       = 60;       // seconds
+int    host_num_sensors    = 2;
+int    host_num_centrals   = 1;
+int    host_rate           = 10;       // frames per second of each sensor
+int    host_frame_len      = HELLO_CLIENT_RELAY_MAX_LEN;
+BOOL   host_indications    = FALSE;    // sensors send indications
+BOOL   host_central_indications = FALSE;    // centrals subscribe for indications
+int    host_adv_rate       = 100;      // advertising events per second of the other devices
+int    host_num_advertisers = 20;
+int    host_write_rate     = 1;        // commands per second of each central
+int    host_interval       = 10;       // ms, connection interval of every link
+int    host_tx_buffers     = 8;
+int    host_drop_time      = 0;        // mean seconds between the sensor link drops, 0 never
+int    host_write_rsp_loss = 0;        // percent of the write responses lost
+BOOL   host_roster         = TRUE;     // sensors are bonded and their handles are in the NVRAM
+int    host_num_absent     = 0;        // sensors of the roster which are out of range
+int    host_late_time      = 0;        // seconds before the sensors come in range
+BOOL   host_write_cmd      = FALSE;    // sensor configuration allows write without response
+UINT8  host_app_config     = 0;        // bits set in the application configuration
+BOOL   host_verbose        = FALSE;
+
+// simulated stack
+HOST_CALLBACKS host_cb;
+HOST_LINK      host_link[HOST_MAX_LINKS];
+int            host_context = -1;       // link of the connection mux context, -1 if none
+BOOL           host_mux_used[HOST_MAX_LINKS];
+int            host_mux_size;
+HOST_SENSOR    host_sensor[HOST_MAX_SENSORS];
+HOST_CENTRAL   host_central[HOST_MAX_CENTRALS];
+BD_ADDR        host_advertiser[HOST_MAX_ADVERTISERS];
+HOST_NVRAM     host_nvram[HOST_NVRAM_IDS];
+UINT32         host_now;                // ms
+int            host_tx_free;
+BOOL           host_timers_running;
+UINT8          host_adv_mode = NO_DISCOVERABLE;
+UINT8          host_scan_mode = NO_SCAN;
+UINT16         host_scan_elapsed;       // seconds
+UINT32         host_scan_credit;        // reports of the other devices, times 1000
+UINT8          host_conn_mode = NO_CONN;
+UINT16         host_conn_elapsed;       // seconds
+BOOL           host_conn_accept_list;
+BD_ADDR        host_conn_addr;
+BD_ADDR        host_accept_list[HOST_MAX_SENSORS];
+int            host_accept_list_size;
+unsigned int   host_random_state = 1;
+
+// results
+HOST_COST      host_cost[HOST_EVENT_NUM];
+unsigned long long host_queue_sum;
+UINT32         host_queue_max;
+UINT32         host_tx_overruns;        // packets sent while no TX buffer was free
+UINT32         host_mux_switches;
+UINT32         host_conn_param_updates;
+UINT32         host_adv_reports;
+UINT32         host_client_pdus;        // notifications and indications sent by the sensors to the client
+UINT32         host_timer_stops;
+UINT32         host_timers_stopped_time;    // ms
+UINT32         host_central_blocked_time;   // ms a central waited while the client did not advertise
+
+const char *host_event_name[HOST_EVENT_NUM] =
+{
+    "conn_up", "conn_down", "notification", "indication", "adv_report", "write",
+    "att_rsp", "encryption", "ind_cfm", "fine_timer", "app_timer", "timer_cb",
+};
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+unsigned long long host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void host_cost_record(int event, unsigned long long cycles)
+{
+    host_cost[event].count++;
+    host_cost[event].sum += cycles;
+    if (cycles > host_cost[event].max)
+    {
+        host_cost[event].max = cycles;
+    }
+}
+
+// run the callback of the application and count its cost
+#define HOST_CALL(event, call) \
+    do \
+    { \
+        unsigned long long start_ = host_cycles(); \
+        call; \
+        host_cost_record(event, host_cycles() - start_); \
+    } while (0)
+
+// same sequence on every run with the same seed
+unsigned int host_random(void)
+{
+    host_random_state ^= host_random_state << 13;
+    host_random_state ^= host_random_state >> 17;
+    host_random_state ^= host_random_state << 5;
+    return host_random_state;
+}
+
+HOST_LINK *host_current(void)
+{
+    return (host_context >= 0) ? &host_link[host_context] : NULL;
+}
+
+// take a TX buffer for a packet sent in the current context
+void host_send_packet(void)
+{
+    if (host_tx_free == 0)
+    {
+        host_tx_overruns++;
+        return;
+    }
+    host_tx_free--;
+    host_current()->tx_queued++;
+}
+
+/******************************************************
+ *               ROM shim
+ ******************************************************/
+void host_trace(const char *fmt, UINT32 a, UINT32 b, UINT32 c, UINT32 d)
+{
+    if (!host_verbose)
+    {
+        return;
+    }
+    printf("%6u.%03u ", host_now / 1000, host_now % 1000);
+    printf(fmt, a, b, c, d);
+    if ((fmt[0] == 0) || (fmt[strlen(fmt) - 1] != '\n'))
+    {
+        printf("\n");
+    }
+}
+
+void ble_trace0(const char *fmt)                                        { host_trace(fmt, 0, 0, 0, 0); }
+void ble_trace1(const char *fmt, UINT32 a)                              { host_trace(fmt, a, 0, 0, 0); }
+void ble_trace2(const char *fmt, UINT32 a, UINT32 b)                    { host_trace(fmt, a, b, 0, 0); }
+void ble_trace3(const char *fmt, UINT32 a, UINT32 b, UINT32 c)          { host_trace(fmt, a, b, c, 0); }
+void ble_trace4(const char *fmt, UINT32 a, UINT32 b, UINT32 c, UINT32 d){ host_trace(fmt, a, b, c, d); }
+void ble_tracen(char *p, int len)                                       { }
+
+void wdog_restart(void) { }
+
+void *emconinfo_getPtr(void)
+{
+    return &host_current()->dev_info;
+}
+
+UINT16 emconinfo_getConnHandle(void)
+{
+    return (host_context >= 0) ? host_link[host_context].con_handle : 0;
+}
+
+UINT8 emconinfo_getDiscReason(void)
+{
+    return 0x13;
+}
+
+void *emconninfo_getPeerAddr(void)
+{
+    HOST_LINK *p_link = host_current();
+
+    return (p_link->role == CENTRAL_ROLE) ? host_sensor[p_link->peer].bdaddr : host_central[p_link->peer].bdaddr;
+}
+
+void *emconninfo_getPeerPubAddr(void)
+{
+    return emconninfo_getPeerAddr();
+}
+
+void *lesmp_getPtr(void)                        { return &host_current()->smp_info; }
+void  lesmp_setPtr(void *p)                     { }
+void  lesmp_startPairing(void *p)               { host_current()->encrypt_pending = TRUE; }
+void  lesmp_regSMPResultCb(LESMP_SINGLE_PARAM_CB cb) { host_cb.smp_result = cb; }
+void  lesmp_setPairingParam(UINT8 io_cap, UINT8 oob, UINT8 auth_req, UINT8 max_key_size,
+                            UINT8 init_key_distrib, UINT8 resp_key_distrib) { }
+void  lesmpkeys_removeAllBondInfo(void)         { }
+void  lesmp_l2capHandler(LEL2CAP_HDR *l2capHdr) { }
+
+// RSSI is the same on every link
+INT8 lm_getRSSI(UINT8 con_handle)
+{
+    return -60;
+}
+
+void lel2cap_regConnLessHandler(UINT16 cid, LEL2CAP_L2CAPHANDLER handler) { }
+
+void lel2cap_sendConnParamUpdateReq(UINT16 min_interval, UINT16 max_interval, UINT16 latency, UINT16 timeout)
+{
+    host_conn_param_updates++;
+}
+
+UINT16 legattdb_getHandle(LEGATTDB_ENTRY_HDR *p)        { return p->handle; }
+int    legattdb_getAttrValueLen(LEGATTDB_ENTRY_HDR *p)  { return p->len; }
+UINT8 *legattdb_getAttrValue(LEGATTDB_ENTRY_HDR *p)     { return p->value; }
+void   legattdb_regWriteHandleCb(LEGATTDB_WRITE_CB cb)  { host_cb.write = cb; }
+void   legattdb_dumpDb(void)                            { }
+
+void leatt_regNotificationCb(LEATT_TRIPLE_PARAM_CB cb)       { host_cb.notification = cb; }
+void leatt_regIndicationCb(LEATT_TRIPLE_PARAM_CB cb)         { host_cb.indication = cb; }
+void leatt_regReadRspCb(LEATT_TRIPLE_PARAM_CB cb)            { host_cb.read_rsp = cb; }
+void leatt_regReadByTypeRspCb(LEATT_TRIPLE_PARAM_CB cb)      { host_cb.read_by_type_rsp = cb; }
+void leatt_regReadByGroupTypeRspCb(LEATT_TRIPLE_PARAM_CB cb) { host_cb.read_by_group_type_rsp = cb; }
+void leatt_regWriteRspCb(LEATT_NO_PARAM_CB cb)               { host_cb.write_rsp = cb; }
+
+void blecm_ConMuxInit(int num)
+{
+    host_mux_size = (num < HOST_MAX_LINKS) ? num : HOST_MAX_LINKS;
+}
+
+void blecm_enableConMux(void)      { }
+void blecm_enablescatternet(void)  { }
+
+int blecm_FindFreeConMux(void)
+{
+    int i;
+
+    for (i = 0; i < host_mux_size; i++)
+    {
+        if (!host_mux_used[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void blecm_AddConMux(int index, UINT16 con_handle, int db_size, void *db, void *dev_info, void *smp_info)
+{
+    host_mux_used[index] = TRUE;
+}
+
+void blecm_DelConMux(int index)
+{
+    host_mux_used[index] = FALSE;
+}
+
+void blecm_SetPtrConMux(UINT16 con_handle)
+{
+    int i;
+
+    host_mux_switches++;
+    for (i = 0; i < HOST_MAX_LINKS; i++)
+    {
+        if (host_link[i].up && (host_link[i].con_handle == con_handle))
+        {
+            host_context = i;
+            return;
+        }
+    }
+}
+
+int blecm_getAvailableTxBuffers(void)
+{
+    return host_tx_free;
+}
+
+void blecm_disconnect(UINT8 reason)
+{
+    host_current()->down_pending = TRUE;
+}
+
+void blecm_setAdvDuringConnEnable(BOOL enable) { }
+
+void blecm_clearWhiteList(void)
+{
+    host_accept_list_size = 0;
+}
+
+void blecm_addWhiteList(UINT8 addr_type, UINT8 *bdaddr)
+{
+    if (host_accept_list_size < HOST_MAX_SENSORS)
+    {
+        memcpy(host_accept_list[host_accept_list_size++], bdaddr, sizeof(BD_ADDR));
+    }
+}
+
+void blecm_RegleAdvReportCb(BLECM_FUNC_WITH_PARAM cb)                 { host_cb.adv_report = cb; }
+void blecm_regEncryptionChangedHandler(void (*cb)(HCI_EVT_HDR *evt))  { host_cb.encryption_changed = cb; }
+
+void blecen_Create(void) { }
+
+void blecen_Scan(UINT8 mode)
+{
+    host_scan_mode    = mode;
+    host_scan_elapsed = 0;
+}
+
+UINT8 blecen_GetScan(void)
+{
+    return host_scan_mode;
+}
+
+void blecen_Conn(UINT8 mode, UINT8 *bdaddr, UINT8 addr_type)
+{
+    host_conn_mode        = mode;
+    host_conn_elapsed     = 0;
+    host_conn_accept_list = (blecen_cen_cfg.init_filter_policy == HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_USED);
+    if (bdaddr != NULL)
+    {
+        memcpy(host_conn_addr, bdaddr, sizeof(BD_ADDR));
+    }
+}
+
+UINT8 blecen_GetConn(void)
+{
+    return host_conn_mode;
+}
+
+// scan and connection timeouts run from the application timer, like in the ROM
+void blecen_appTimerCb(UINT32 arg)
+{
+    if (arg != BLEPROFILE_GENERIC_APP_TIMER)
+    {
+        return;
+    }
+    if (host_scan_mode != NO_SCAN)
+    {
+        host_scan_elapsed++;
+    }
+    if (host_conn_mode != NO_CONN)
+    {
+        host_conn_elapsed++;
+    }
+}
+
+void blecen_connDown(void)                                       { }
+void blecen_leAdvReportCb(HCIULP_ADV_PACKET_REPORT_WDATA *evt)   { }
+void blecen_encryptionChanged(HCI_EVT_HDR *evt)                  { }
+void blecen_smpBondResult(LESMP_PARING_RESULT result)            { }
+void blecli_ClientHandleReset(void)                              { }
+
+void bleapp_set_cfg(UINT8 *db, int db_size, void *cfg, void *puart_cfg, void *gpio_cfg, void (*create)(void))
+{
+    bleprofile_p_cfg      = (BLE_PROFILE_CFG *)cfg;
+    bleprofile_gpio_p_cfg = (BLE_PROFILE_GPIO_CFG *)gpio_cfg;
+    host_cb.create        = create;
+}
+
+void bleprofile_Init(BLE_PROFILE_CFG *cfg)                 { }
+void bleprofile_GPIOInit(BLE_PROFILE_GPIO_CFG *cfg)        { }
+void bleprofile_regIntCb(UINT32 (*cb)(UINT32 value))       { host_cb.interrupt = cb; }
+
+void bleprofile_regAppEvtHandler(UINT8 evt, void (*cb)(void))
+{
+    if (evt == BLECM_APP_EVT_LINK_UP)
+    {
+        host_cb.conn_up = cb;
+    }
+    else
+    {
+        host_cb.conn_down = cb;
+    }
+}
+
+void bleprofile_regTimerCb(BLEAPP_TIMER_CB fine_cb, BLEAPP_TIMER_CB cb)
+{
+    host_cb.fine_timer = fine_cb;
+    host_cb.app_timer  = cb;
+}
+
+void bleprofile_StartTimer(void)
+{
+    host_timers_running = TRUE;
+}
+
+void bleprofile_KillTimer(void)
+{
+    // timers are restarted right away when the application is created
+    if (host_timers_running && (host_cb.conn_up != NULL))
+    {
+        host_timer_stops++;
+        ble_trace0("host: timers stopped\n");
+    }
+    host_timers_running = FALSE;
+}
+
+void bleprofile_Discoverable(UINT8 mode, UINT8 *bdaddr)
+{
+    host_adv_mode = mode;
+}
+
+int bleprofile_ReadNVRAM(UINT8 id, UINT8 len, UINT8 *buf)
+{
+    if ((id >= HOST_NVRAM_IDS) || (host_nvram[id].len == 0))
+    {
+        return 0;
+    }
+    if (len > host_nvram[id].len)
+    {
+        len = host_nvram[id].len;
+    }
+    memcpy(buf, host_nvram[id].data, len);
+    return len;
+}
+
+int bleprofile_WriteNVRAM(UINT8 id, UINT8 len, UINT8 *buf)
+{
+    if ((id >= HOST_NVRAM_IDS) || (len > HOST_NVRAM_MAX_LEN))
+    {
+        return 0;
+    }
+    memcpy(host_nvram[id].data, buf, len);
+    host_nvram[id].len = len;
+    return len;
+}
+
+BOOL bleprofile_DeleteNVRAM(UINT8 id)
+{
+    if (id < HOST_NVRAM_IDS)
+    {
+        host_nvram[id].len = 0;
+    }
+    return TRUE;
+}
+
+void bleprofile_WriteHandle(UINT16 handle, BLEPROFILE_DB_PDU *p_pdu) { }
+
+void bleprofile_sendNotification(UINT16 handle, UINT8 *data, int len)
+{
+    HOST_LINK *p_link = host_current();
+
+    host_send_packet();
+    if (p_link->role == PERIPHERAL_ROLE)
+    {
+        host_central[p_link->peer].frames++;
+        host_central[p_link->peer].bytes += len;
+    }
+}
+
+void bleprofile_sendIndication(UINT16 handle, UINT8 *data, int len, void (*cb)(void))
+{
+    HOST_LINK *p_link = host_current();
+
+    bleprofile_sendNotification(handle, data, len);
+    p_link->indication_cfm = cb;
+    p_link->indication_due = TRUE;
+}
+
+void bleprofile_sendHandleValueConf(void)
+{
+    host_send_packet();
+    host_current()->conf_due = TRUE;
+}
+
+// write to the simulated sensor, subscription or a command
+void host_sensor_write(UINT16 handle, UINT8 *data, int len)
+{
+    HOST_SENSOR *p_sensor = &host_sensor[host_current()->peer];
+
+    if (handle == HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR)
+    {
+        p_sensor->subscribed = (len >= 1) && (data[0] & (CCC_NOTIFICATION | CCC_INDICATION));
+    }
+    else if (handle == HANDLE_HELLO_SENSOR_CONFIGURATION)
+    {
+        p_sensor->commands++;
+    }
+}
+
+void bleprofile_sendWriteCmd(UINT16 handle, UINT8 *data, int len)
+{
+    host_send_packet();
+    host_sensor_write(handle, data, len);
+}
+
+void bleprofile_sendWriteReq(UINT16 handle, UINT8 *data, int len)
+{
+    host_send_packet();
+    host_sensor_write(handle, data, len);
+    if ((int)(host_random() % 100) >= host_write_rsp_loss)
+    {
+        host_current()->write_rsp_due++;
+    }
+}
+
+void bleprofile_sendReadByGroupTypeReq(UINT16 start_handle, UINT16 end_handle, UINT16 uuid)
+{
+    host_send_packet();
+    host_current()->rsp_type  = HOST_RSP_GROUP_TYPE;
+    host_current()->rsp_start = start_handle;
+    host_current()->rsp_uuid  = uuid;
+}
+
+void bleprofile_sendReadByTypeReq(UINT16 start_handle, UINT16 end_handle, UINT16 uuid)
+{
+    host_send_packet();
+    host_current()->rsp_type  = HOST_RSP_TYPE;
+    host_current()->rsp_start = start_handle;
+    host_current()->rsp_uuid  = uuid;
+}
+
+void devlpm_registerForLowPowerQueries(UINT32 (*cb)(LowPowerModePollType type, UINT32 context), UINT32 context)
+{
+    host_cb.lpm_query = cb;
+}
+
+/******************************************************
+ *               Simulated devices
+ ******************************************************/
+int host_free_link(void)
+{
+    int i;
+
+    for (i = 0; i < HOST_MAX_LINKS; i++)
+    {
+        if (!host_link[i].up)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// controller established the link, tell the application
+void host_link_up(int index, UINT8 role, int peer)
+{
+    HOST_LINK *p_link = &host_link[index];
+
+    memset(p_link, 0, sizeof(HOST_LINK));
+    p_link->up            = TRUE;
+    p_link->con_handle    = RMULP_CONN_HANDLE_START + index;
+    p_link->role          = role;
+    p_link->peer          = peer;
+    p_link->dev_info.role = role;
+    p_link->phase         = host_random() % host_interval;
+
+    if (role == CENTRAL_ROLE)
+    {
+        host_sensor[peer].link = index;
+        host_sensor[peer].connects++;
+    }
+    else
+    {
+        host_central[peer].link      = index;
+        host_central[peer].encrypted = FALSE;
+        host_central[peer].subscribed = FALSE;
+        host_central[peer].connects++;
+
+        // central starts the encryption with the keys saved from the bonding
+        p_link->encrypt_pending = TRUE;
+    }
+
+    host_context = index;
+    HOST_CALL(HOST_EVENT_CONN_UP, host_cb.conn_up());
+    host_context = -1;
+}
+
+void host_link_down(int index)
+{
+    HOST_LINK *p_link = &host_link[index];
+
+    host_context = index;
+    HOST_CALL(HOST_EVENT_CONN_DOWN, host_cb.conn_down());
+    host_context = -1;
+
+    host_tx_free += p_link->tx_queued;
+    if (p_link->role == CENTRAL_ROLE)
+    {
+        HOST_SENSOR *p_sensor = &host_sensor[p_link->peer];
+
+        p_sensor->link          = -1;
+        p_sensor->subscribed    = FALSE;
+        p_sensor->backlog       = 0;
+        p_sensor->segments_left = 0;
+        p_sensor->confirm_wait  = FALSE;
+    }
+    else
+    {
+        host_central[p_link->peer].link      = -1;
+        host_central[p_link->peer].waiting   = TRUE;
+        host_central[p_link->peer].want_time = host_now + HOST_CENTRAL_RECONNECT_TIME;
+    }
+    p_link->up = FALSE;
+}
+
+// sensor ends the connection, it advertises again after a while
+void host_sensor_drop(int index)
+{
+    HOST_SENSOR *p_sensor = &host_sensor[index];
+
+    host_link_down(p_sensor->link);
+    p_sensor->online_time = host_now + HOST_SENSOR_OFFLINE_TIME;
+}
+
+BOOL host_sensor_in_accept_list(HOST_SENSOR *p_sensor)
+{
+    int i;
+
+    for (i = 0; i < host_accept_list_size; i++)
+    {
+        if (memcmp(host_accept_list[i], p_sensor->bdaddr, sizeof(BD_ADDR)) == 0)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// report is heard with the probability of the scan duty cycle
+BOOL host_scan_hears(void)
+{
+    UINT32 window   = (host_scan_mode == HIGH_SCAN) ? blecen_cen_cfg.high_scan_window : blecen_cen_cfg.low_scan_window;
+    UINT32 interval = (host_scan_mode == HIGH_SCAN) ? blecen_cen_cfg.high_scan_interval : blecen_cen_cfg.low_scan_interval;
+
+    return (host_scan_mode != NO_SCAN) && (interval != 0) && (host_random() % interval < window);
+}
+
+void host_adv_report(UINT8 event_type, UINT8 *bdaddr, UINT8 *data, int len, INT8 rssi)
+{
+    HCIULP_ADV_PACKET_REPORT_WDATA evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.eventType   = event_type;
+    evt.addressType = HCIULP_PUBLIC_ADDRESS;
+    memcpy(evt.wd_addr, bdaddr, sizeof(BD_ADDR));
+    evt.dataLen     = len;
+    memcpy(evt.data, data, len);
+    evt.rssi        = rssi;
+
+    host_adv_reports++;
+    HOST_CALL(HOST_EVENT_ADV_REPORT, host_cb.adv_report(&evt));
+}
+
+// advertisement of the sensor carries the service, the scan response carries the name
+void host_sensor_advertise(HOST_SENSOR *p_sensor)
+{
+    UINT8 adv[3 + 18]        = {0x02, 0x01, 0x06, 0x11, ADV_SERVICE_UUID128_COMP, UUID_HELLO_SERVICE};
+    UINT8 scan_rsp[2 + 12]   = {0x0d, 0x09, 'H', 'e', 'l', 'l', 'o', ' ', 'S', 'e', 'n', 's', 'o', 'r'};
+    int   index              = p_sensor - host_sensor;
+    int   i;
+
+    // controller creates the connection to the sensor it is connecting to
+    if ((host_conn_mode != NO_CONN) &&
+        (host_conn_accept_list ? host_sensor_in_accept_list(p_sensor) :
+                                 (memcmp(host_conn_addr, p_sensor->bdaddr, sizeof(BD_ADDR)) == 0)) &&
+        ((i = host_free_link()) >= 0))
+    {
+        host_conn_mode = NO_CONN;
+        host_link_up(i, CENTRAL_ROLE, index);
+        return;
+    }
+
+    if (host_scan_hears())
+    {
+        host_adv_report(HOST_ADV_IND, p_sensor->bdaddr, adv, sizeof(adv), -50 - index);
+        if (host_scan_hears())
+        {
+            host_adv_report(HOST_SCAN_RSP, p_sensor->bdaddr, scan_rsp, sizeof(scan_rsp), -50 - index);
+        }
+    }
+}
+
+// advertisement of a device which is not a Hello Sensor, and its scan response
+void host_other_advertise(void)
+{
+    UINT8 adv[3 + 4 + 20] = {0x02, 0x01, 0x06, 0x03, 0x03, 0x0f, 0x18, 0x13, 0xff, 0x31, 0x01};
+    UINT8 scan_rsp[2 + 8] = {0x09, 0x09, 'A', 'n', 'y', ' ', 'T', 'a', 'g', 0};
+    UINT8 *bdaddr         = host_advertiser[host_random() % host_num_advertisers];
+
+    host_adv_report(HOST_ADV_IND, bdaddr, adv, sizeof(adv), -70);
+    if (host_scan_hears())
+    {
+        host_adv_report(HOST_SCAN_RSP, bdaddr, scan_rsp, sizeof(scan_rsp), -70);
+    }
+}
+
+// send the next frame from the backlog, or the next segment of the record
+void host_sensor_send(HOST_SENSOR *p_sensor, HOST_LINK *p_link)
+{
+    UINT8 frame[HELLO_CLIENT_RELAY_MAX_LEN];
+    int   len = (host_frame_len < HELLO_CLIENT_RELAY_MAX_LEN) ? host_frame_len : HELLO_CLIENT_RELAY_MAX_LEN;
+    int   i;
+
+    for (i = 0; i < len; i++)
+    {
+        frame[i] = (UINT8)(p_sensor->frames_sent + i);
+    }
+
+    if (host_app_config & RELAY_SEGMENTED)
+    {
+        // records are cut into segments of one notification
+        int segments = (host_frame_len + HELLO_CLIENT_RELAY_MAX_LEN - 2) / (HELLO_CLIENT_RELAY_MAX_LEN - 1);
+
+        if (p_sensor->segments_left == 0)
+        {
+            p_sensor->segments_left = segments;
+            p_sensor->seg_seq       = 0;
+        }
+        frame[0] = p_sensor->seg_seq;
+        if (p_sensor->segments_left == segments)
+        {
+            frame[0] |= HELLO_SENSOR_SEG_FIRST;
+        }
+        if (p_sensor->segments_left == 1)
+        {
+            frame[0] |= HELLO_SENSOR_SEG_LAST;
+            len = host_frame_len - (segments - 1) * (HELLO_CLIENT_RELAY_MAX_LEN - 1) + 1;
+        }
+        else
+        {
+            len = HELLO_CLIENT_RELAY_MAX_LEN;
+        }
+        p_sensor->seg_seq = (p_sensor->seg_seq + 1) & HELLO_SENSOR_SEG_SEQ_MASK;
+        if (--p_sensor->segments_left == 0)
+        {
+            p_sensor->backlog--;
+            p_sensor->frames_sent++;
+        }
+    }
+    else
+    {
+        p_sensor->backlog--;
+        p_sensor->frames_sent++;
+    }
+
+    host_client_pdus++;
+    host_context = p_link - host_link;
+    if (host_indications)
+    {
+        p_sensor->confirm_wait       = TRUE;
+        p_sensor->confirm_wait_start = host_now;
+        HOST_CALL(HOST_EVENT_INDICATION, host_cb.indication(len, len, frame));
+    }
+    else
+    {
+        HOST_CALL(HOST_EVENT_NOTIFICATION, host_cb.notification(len, len, frame));
+    }
+    host_context = -1;
+}
+
+// sensor responds to the discovery of its GATT database
+void host_sensor_respond(HOST_LINK *p_link)
+{
+    UINT8 service[20]         = {BIT16_TO_8(HANDLE_HELLO_SENSOR_SERVICE_UUID), BIT16_TO_8(HOST_SENSOR_SERVICE_END), UUID_HELLO_SERVICE};
+    UINT8 characteristics[42] = {BIT16_TO_8(HOST_SENSOR_DATA_DECLARATION), LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_NOTIFY,
+                                 BIT16_TO_8(HANDLE_HELLO_SENSOR_VALUE_NOTIFY), UUID_HELLO_CHARACTERISTIC_NOTIFY,
+                                 BIT16_TO_8(HOST_SENSOR_CONFIG_DECLARATION), LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE,
+                                 BIT16_TO_8(HANDLE_HELLO_SENSOR_CONFIGURATION), UUID_HELLO_CHARACTERISTIC_CONFIG};
+    UINT8 descriptor[4]       = {BIT16_TO_8(HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR), 0, 0};
+    UINT8 type                = p_link->rsp_type;
+
+    p_link->rsp_type = HOST_RSP_NONE;
+
+    // requests past the end of the database are not answered
+    if ((type == HOST_RSP_GROUP_TYPE) && (p_link->rsp_start <= HANDLE_HELLO_SENSOR_SERVICE_UUID))
+    {
+        HOST_CALL(HOST_EVENT_ATT_RSP, host_cb.read_by_group_type_rsp(sizeof(service), sizeof(service), service));
+    }
+    else if ((type == HOST_RSP_TYPE) && (p_link->rsp_uuid == UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION) &&
+             (p_link->rsp_start <= HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR))
+    {
+        HOST_CALL(HOST_EVENT_ATT_RSP, host_cb.read_by_type_rsp(sizeof(descriptor), sizeof(descriptor), descriptor));
+    }
+    else if ((type == HOST_RSP_TYPE) && (p_link->rsp_uuid == UUID_ATTRIBUTE_CHARACTERISTIC) &&
+             (p_link->rsp_start <= HOST_SENSOR_DATA_DECLARATION))
+    {
+        HOST_CALL(HOST_EVENT_ATT_RSP, host_cb.read_by_type_rsp(sizeof(characteristics), sizeof(characteristics) / 2, characteristics));
+    }
+}
+
+void host_central_write(HOST_LINK *p_link, UINT16 handle, UINT8 *data, int len)
+{
+    LEGATTDB_ENTRY_HDR entry;
+
+    entry.handle = handle;
+    entry.len    = len;
+    entry.value  = data;
+
+    host_context = p_link - host_link;
+    HOST_CALL(HOST_EVENT_WRITE, host_cb.write(&entry));
+    host_context = -1;
+}
+
+// connection event of the link, both sides send what they have
+void host_connection_event(HOST_LINK *p_link)
+{
+    int index = p_link - host_link;
+    int sent;
+
+    sent = (p_link->tx_queued < HOST_PACKETS_PER_EVENT) ? p_link->tx_queued : HOST_PACKETS_PER_EVENT;
+    p_link->tx_queued -= sent;
+    host_tx_free      += sent;
+
+    if (p_link->encrypt_pending)
+    {
+        UINT8 evt[sizeof(HCI_EVT_HDR) + 4] = {0};
+
+        p_link->encrypt_pending = FALSE;
+        host_context = index;
+        HOST_CALL(HOST_EVENT_ENCRYPTION, host_cb.encryption_changed((HCI_EVT_HDR *)evt));
+        host_context = -1;
+        if (p_link->role == PERIPHERAL_ROLE)
+        {
+            host_central[p_link->peer].encrypted = TRUE;
+        }
+        return;
+    }
+
+    if (p_link->role == PERIPHERAL_ROLE)
+    {
+        HOST_CENTRAL *p_central = &host_central[p_link->peer];
+
+        if (p_link->indication_due)
+        {
+            p_link->indication_due = FALSE;
+            host_context = index;
+            HOST_CALL(HOST_EVENT_INDICATION_CFM, p_link->indication_cfm());
+            host_context = -1;
+        }
+        if (p_link->up && p_central->encrypted && !p_central->subscribed)
+        {
+            UINT8 ccc[2] = {host_central_indications ? CCC_INDICATION : CCC_NOTIFICATION, 0};
+
+            p_central->subscribed = TRUE;
+            host_central_write(p_link, HANDLE_HELLO_CLIENT_CLIENT_CONFIGURATION_DESCRIPTOR, ccc, sizeof(ccc));
+        }
+        else if (p_link->up && p_central->subscribed && (p_central->cmd_credit >= 1000))
+        {
+            UINT8 cmd[2] = {HELLO_CLIENT_CMD_TARGET_ALL, 0x01};
+
+            p_central->cmd_credit -= 1000;
+            p_central->commands++;
+            host_central_write(p_link, HANDLE_HELLO_CLIENT_DATA_VALUE, cmd, sizeof(cmd));
+        }
+        return;
+    }
+
+    // sensor link
+    {
+        HOST_SENSOR *p_sensor = &host_sensor[p_link->peer];
+        int i;
+
+        if (p_link->write_rsp_due != 0)
+        {
+            p_link->write_rsp_due--;
+            host_context = index;
+            HOST_CALL(HOST_EVENT_ATT_RSP, host_cb.write_rsp());
+            host_context = -1;
+        }
+        if (p_link->up && (p_link->rsp_type != HOST_RSP_NONE))
+        {
+            host_context = index;
+            host_sensor_respond(p_link);
+            host_context = -1;
+        }
+        if (p_link->conf_due)
+        {
+            p_link->conf_due = FALSE;
+            if (host_now - p_sensor->confirm_wait_start > p_sensor->confirm_wait_max)
+            {
+                p_sensor->confirm_wait_max = host_now - p_sensor->confirm_wait_start;
+            }
+            p_sensor->confirm_wait = FALSE;
+        }
+        for (i = 0; (i < HOST_PACKETS_PER_EVENT) && p_link->up && p_sensor->subscribed &&
+                    (p_sensor->backlog != 0) && !p_sensor->confirm_wait; i++)
+        {
+            host_sensor_send(p_sensor, p_link);
+        }
+    }
+}
+
+// step of 1 ms of the simulated stack
+void host_step(void)
+{
+    int i;
+
+    // links the client disconnected
+    for (i = 0; i < HOST_MAX_LINKS; i++)
+    {
+        if (host_link[i].up && host_link[i].down_pending)
+        {
+            host_link_down(i);
+        }
+    }
+
+    // sensors which are not connected advertise
+    for (i = 0; i < host_num_sensors; i++)
+    {
+        HOST_SENSOR *p_sensor = &host_sensor[i];
+
+        if ((p_sensor->link < 0) && (host_now >= p_sensor->online_time) &&
+            ((host_now % HOST_SENSOR_ADV_INTERVAL) == p_sensor->adv_phase))
+        {
+            host_sensor_advertise(p_sensor);
+        }
+    }
+
+    // other devices advertise, reports arrive while client scans
+    if (host_scan_mode != NO_SCAN)
+    {
+        for (host_scan_credit += host_adv_rate; host_scan_credit >= 1000; host_scan_credit -= 1000)
+        {
+            if (host_scan_hears())
+            {
+                host_other_advertise();
+            }
+        }
+    }
+
+    // centrals connect while client advertises
+    for (i = 0; i < host_num_centrals; i++)
+    {
+        HOST_CENTRAL *p_central = &host_central[i];
+        int link;
+
+        if (!p_central->waiting || (host_now < p_central->want_time))
+        {
+            continue;
+        }
+        if (host_adv_mode == NO_DISCOVERABLE)
+        {
+            host_central_blocked_time++;
+            continue;
+        }
+        if (((host_random() % HOST_CENTRAL_ADV_CHANCE) == 0) && ((link = host_free_link()) >= 0))
+        {
+            p_central->waiting = FALSE;
+            if (host_now - p_central->want_time > p_central->connect_wait_max)
+            {
+                p_central->connect_wait_max = host_now - p_central->want_time;
+            }
+            host_link_up(link, PERIPHERAL_ROLE, i);
+        }
+    }
+
+    // traffic generators
+    for (i = 0; i < host_num_sensors; i++)
+    {
+        HOST_SENSOR *p_sensor = &host_sensor[i];
+
+        if ((p_sensor->link < 0) || !p_sensor->subscribed)
+        {
+            continue;
+        }
+        for (p_sensor->credit += host_rate; p_sensor->credit >= 1000; p_sensor->credit -= 1000)
+        {
+            if (p_sensor->backlog < HOST_SENSOR_BACKLOG)
+            {
+                p_sensor->backlog++;
+            }
+            else
+            {
+                p_sensor->frames_lost++;
+            }
+        }
+
+        // sensor gives up on the indication which is not confirmed
+        if (p_sensor->confirm_wait && (host_now - p_sensor->confirm_wait_start >= HOST_ATT_TIMEOUT))
+        {
+            p_sensor->att_timeouts++;
+            host_sensor_drop(i);
+            continue;
+        }
+
+        if ((host_drop_time != 0) && ((host_random() % (host_drop_time * 1000)) == 0))
+        {
+            host_sensor_drop(i);
+        }
+    }
+    for (i = 0; i < host_num_centrals; i++)
+    {
+        if (host_central[i].link >= 0)
+        {
+            host_central[i].cmd_credit += host_write_rate;
+        }
+    }
+
+    for (i = 0; i < HOST_MAX_LINKS; i++)
+    {
+        if (host_link[i].up && ((host_now % host_interval) == host_link[i].phase))
+        {
+            host_connection_event(&host_link[i]);
+        }
+    }
+
+    if (host_timers_running)
+    {
+        if ((host_now % bleprofile_p_cfg->fine_timer_interval) == 0)
+        {
+            HOST_CALL(HOST_EVENT_FINE_TIMER, host_cb.fine_timer(0));
+        }
+        if ((host_now % 1000) == 0)
+        {
+            HOST_CALL(HOST_EVENT_APP_TIMER, host_cb.app_timer(BLEPROFILE_GENERIC_APP_TIMER));
+        }
+    }
+    else
+    {
+        host_timers_stopped_time++;
+    }
+
+    // scan and connection which ran for their duration
+    if ((host_scan_mode != NO_SCAN) &&
+        (host_scan_elapsed >= ((host_scan_mode == HIGH_SCAN) ? blecen_cen_cfg.high_scan_duration : blecen_cen_cfg.low_scan_duration)))
+    {
+        UINT8 mode = host_scan_mode;
+
+        HOST_CALL(HOST_EVENT_TIMER_CALLBACK, blecen_usertimerCb(BLEAPP_APP_TIMER_SCAN));
+        if ((host_scan_mode == mode) && (host_scan_elapsed != 0))
+        {
+            host_scan_mode = NO_SCAN;
+        }
+    }
+    if ((host_conn_mode != NO_CONN) && (host_conn_elapsed >= HOST_CONN_TIMEOUT))
+    {
+        HOST_CALL(HOST_EVENT_TIMER_CALLBACK, blecen_usertimerCb(BLEAPP_APP_TIMER_CONN));
+        if (host_conn_elapsed >= HOST_CONN_TIMEOUT)
+        {
+            host_conn_mode = NO_CONN;
+        }
+    }
+
+    host_queue_sum += hello_client.relay_queued;
+    if (hello_client.relay_queued > host_queue_max)
+    {
+        host_queue_max = hello_client.relay_queued;
+    }
+}
+
+// sensors of the roster were bonded before the reset, their handles are in the NVRAM
+void host_roster_save(void)
+{
+    HELLO_CLIENT_PEER_CACHE cache;
+    int i;
+
+    for (i = 0; (i < host_num_sensors + host_num_absent) && (i < HELLO_CLIENT_PEER_CACHE_SIZE); i++)
+    {
+        BD_ADDR absent = {0x01, 0x80 + i, 0x00, 0x5e, 0x50, 0x00};
+
+        memset(&cache, 0, sizeof(cache));
+        memcpy(cache.bdaddr, (i < host_num_sensors) ? host_sensor[i].bdaddr : absent, sizeof(BD_ADDR));
+        cache.service_start_handle   = HANDLE_HELLO_SENSOR_SERVICE_UUID;
+        cache.service_end_handle     = HOST_SENSOR_SERVICE_END;
+        cache.data_handle            = HANDLE_HELLO_SENSOR_VALUE_NOTIFY;
+        cache.config_handle          = HANDLE_HELLO_SENSOR_CONFIGURATION;
+        cache.data_descriptor_handle = HANDLE_HELLO_SENSOR_CLIENT_CONFIGURATION_DESCRIPTOR;
+        cache.config_properties      = LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_WRITE |
+                                       (host_write_cmd ? LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE : 0);
+        cache.addr_type              = HCIULP_PUBLIC_ADDRESS;
+        cache.priority               = HELLO_CLIENT_PRIORITY_NORMAL;
+        cache.hash                   = hello_client_peer_cache_hash(&cache);
+        bleprofile_WriteNVRAM(NVRAM_ID_PEER_CACHE + i, sizeof(cache), (UINT8 *)&cache);
+    }
+}
+
+void host_report(void)
+{
+    UINT32 frames_sent = 0;
+    UINT32 frames_lost = 0;
+    UINT32 commands_in = 0;
+    UINT32 commands_out = 0;
+    UINT32 connects = 0;
+    UINT32 att_timeouts = 0;
+    UINT32 confirm_wait_max = 0;
+    UINT32 central_frames = 0;
+    UINT32 central_bytes = 0;
+    UINT32 connect_wait_max = 0;
+    int i;
+
+    for (i = 0; i < host_num_sensors; i++)
+    {
+        frames_sent  += host_sensor[i].frames_sent;
+        frames_lost  += host_sensor[i].frames_lost;
+        commands_in  += host_sensor[i].commands;
+        connects     += host_sensor[i].connects;
+        att_timeouts += host_sensor[i].att_timeouts;
+        if (host_sensor[i].confirm_wait_max > confirm_wait_max)
+        {
+            confirm_wait_max = host_sensor[i].confirm_wait_max;
+        }
+    }
+    for (i = 0; i < host_num_centrals; i++)
+    {
+        commands_out   += host_central[i].commands;
+        central_frames += host_central[i].frames;
+        central_bytes  += host_central[i].bytes;
+        if (host_central[i].connect_wait_max > connect_wait_max)
+        {
+            connect_wait_max = host_central[i].connect_wait_max;
+        }
+    }
+
+    printf("run: %d s, sensors:%d rate:%d/s len:%d %s, centrals:%d, adv:%d/s, writes:%d/s, interval:%d ms, tx buffers:%d\n",
+           host_duration, host_num_sensors, host_rate, host_frame_len, host_indications ? "indications" : "notifications",
+           host_num_centrals, host_adv_rate, host_write_rate, host_interval, host_tx_buffers);
+
+    printf("%-14s %10s %12s %12s   (%s)\n", "event", "count", "avg cost", "max cost",
+#if defined(__x86_64__) || defined(__i386__)
+           "TSC cycles"
+#else
+           "ns"
+#endif
+           );
+    for (i = 0; i < HOST_EVENT_NUM; i++)
+    {
+        if (host_cost[i].count != 0)
+        {
+            printf("%-14s %10llu %12llu %12llu\n", host_event_name[i], host_cost[i].count,
+                   host_cost[i].sum / host_cost[i].count, host_cost[i].max);
+        }
+    }
+
+    printf("relay queue: avg depth %.2f, max %u, high water %u\n",
+           (double)host_queue_sum / ((unsigned long long)host_duration * 1000), host_queue_max, hello_client.relay_high_water);
+    printf("sensors: frames sent %u, lost in the sensor backlog %u, connects %u, ATT timeouts %u, max confirmation wait %u ms\n",
+           frames_sent, frames_lost, connects, att_timeouts, confirm_wait_max);
+    printf("client: received %u, overflow drops %u (%.2f%%), link down drops %u, commands dropped %u\n",
+           host_client_pdus, hello_client.relay_overflow_drops,
+           (host_client_pdus != 0) ? 100.0 * hello_client.relay_overflow_drops / host_client_pdus : 0.0,
+           hello_client.relay_link_down_drops, hello_client.cmd_drops);
+    if (host_app_config & RELAY_SEGMENTED)
+    {
+        printf("reassembly: records dropped %u\n", hello_client.reasm_drops);
+    }
+    printf("centrals: PDUs %u, bytes %u, commands written %u, delivered to sensors %u, max connect wait %u ms, waited while not advertising %u ms\n",
+           central_frames, central_bytes, commands_out, commands_in, connect_wait_max, host_central_blocked_time);
+    printf("stack: adv reports %u, TX overruns %u, mux switches %u, conn param updates %u, timer stops %u, timers stopped %u ms\n",
+           host_adv_reports, host_tx_overruns, host_mux_switches, host_conn_param_updates, host_timer_stops, host_timers_stopped_time);
+}
+
+void host_usage(void)
+{
+    printf("usage: hello_client_host [options]\n"
+           "  -t seconds    simulated time (60)\n"
+           "  -s sensors    number of sensors (2)\n"
+           "  -c centrals   number of centrals (1)\n"
+           "  -r rate       frames per second of each sensor (10)\n"
+           "  -l len        frame length, larger than a notification with -S (20)\n"
+           "  -i            sensors send indications\n"
+           "  -I            centrals subscribe for indications\n"
+           "  -a rate       advertising events per second of other devices (100)\n"
+           "  -p num        number of other advertisers (20)\n"
+           "  -w rate       commands per second of each central (1)\n"
+           "  -e ms         connection interval (10)\n"
+           "  -b num        TX buffers (8)\n"
+           "  -d seconds    mean time between sensor link drops, 0 never (0)\n"
+           "  -x percent    write responses lost (0)\n"
+           "  -n            sensors are not in the roster, found by the scan\n"
+           "  -o num        sensors of the roster which are out of range (0)\n"
+           "  -L seconds    sensors come in range after this time (0)\n"
+           "  -W            sensor configuration is written without response\n"
+           "  -g            RELAY_AGGREGATE mode\n"
+           "  -S            RELAY_SEGMENTED mode\n"
+           "  -z seed       random seed (1)\n"
+           "  -v            print the traces\n");
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "t:s:c:r:l:iIa:p:w:e:b:d:x:no:L:WgSz:vh")) != -1)
+    {
+        switch (opt)
+        {
+        case 't': host_duration        = atoi(optarg); break;
+        case 's': host_num_sensors     = atoi(optarg); break;
+        case 'c': host_num_centrals    = atoi(optarg); break;
+        case 'r': host_rate            = atoi(optarg); break;
+        case 'l': host_frame_len       = atoi(optarg); break;
+        case 'i': host_indications     = TRUE; break;
+        case 'I': host_central_indications = TRUE; break;
+        case 'a': host_adv_rate        = atoi(optarg); break;
+        case 'p': host_num_advertisers = atoi(optarg); break;
+        case 'w': host_write_rate      = atoi(optarg); break;
+        case 'e': host_interval        = atoi(optarg); break;
+        case 'b': host_tx_buffers      = atoi(optarg); break;
+        case 'd': host_drop_time       = atoi(optarg); break;
+        case 'x': host_write_rsp_loss  = atoi(optarg); break;
+        case 'n': host_roster          = FALSE; break;
+        case 'o': host_num_absent      = atoi(optarg); break;
+        case 'L': host_late_time       = atoi(optarg); break;
+        case 'W': host_write_cmd       = TRUE; break;
+        case 'g': host_app_config     |= RELAY_AGGREGATE; break;
+        case 'S': host_app_config     |= RELAY_SEGMENTED; break;
+        case 'z': host_random_state    = atoi(optarg) | 1; break;
+        case 'v': host_verbose         = TRUE; break;
+        default:  host_usage(); return 1;
+        }
+    }
+    if ((host_num_sensors < 0) || (host_num_sensors > HOST_MAX_SENSORS) ||
+        (host_num_centrals < 0) || (host_num_centrals > HOST_MAX_CENTRALS) ||
+        (host_num_advertisers < 1) || (host_num_advertisers > HOST_MAX_ADVERTISERS) ||
+        (host_frame_len < 1) || (host_interval < 1) || (host_tx_buffers < 1) ||
+        (!(host_app_config & RELAY_SEGMENTED) && (host_frame_len > HELLO_CLIENT_RELAY_MAX_LEN)) ||
+        ((host_app_config & RELAY_SEGMENTED) && (host_frame_len > HELLO_CLIENT_REASM_MAX_LEN)))
+    {
+        host_usage();
+        return 1;
+    }
+
+    for (i = 0; i < host_num_sensors; i++)
+    {
+        BD_ADDR bdaddr = {0x01, i, 0x00, 0x5e, 0x50, 0x00};
+
+        memcpy(host_sensor[i].bdaddr, bdaddr, sizeof(BD_ADDR));
+        host_sensor[i].link        = -1;
+        host_sensor[i].adv_phase   = host_random() % HOST_SENSOR_ADV_INTERVAL;
+        host_sensor[i].online_time = host_late_time * 1000;
+    }
+    for (i = 0; i < host_num_centrals; i++)
+    {
+        BD_ADDR bdaddr = {0x01, i, 0x00, 0x43, 0x43, 0x00};
+
+        memcpy(host_central[i].bdaddr, bdaddr, sizeof(BD_ADDR));
+        host_central[i].link      = -1;
+        host_central[i].waiting   = TRUE;
+        host_central[i].want_time = 100 + host_random() % 1000;
+    }
+    for (i = 0; i < host_num_advertisers; i++)
+    {
+        BD_ADDR bdaddr = {0x02, i, 0x00, 0x41, 0x41, 0x00};
+
+        memcpy(host_advertiser[i], bdaddr, sizeof(BD_ADDR));
+    }
+    if (host_roster)
+    {
+        host_roster_save();
+    }
+    host_tx_free = host_tx_buffers;
+
+    application_init();
+    host_cb.create();
+    hello_client.app_config |= host_app_config;
+
+    for (host_now = 1; host_now <= (UINT32)host_duration * 1000; host_now++)
+    {
+        host_step();
+    }
+
+    host_report();
+    return 0;
+}
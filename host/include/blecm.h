@@ -0,0 +1,2 @@
+// host shim of the ROM SDK header, see host_rom.h
+#include "host_rom.h"
@@ -0,0 +1,469 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+*
+* Host shim of the 20736 ROM SDK
+*
+* Types, constants and functions of the ROM SDK used by hello_client.c, so
+* that the application can be compiled and run on the host by the harness in
+* hello_client_host.c.  Every SDK header included by the application is a
+* stub which includes this file.  Only what the application uses is here,
+* layouts of the structures and values of the constants are not the ones of
+* the ROM, and the functions are implemented by the harness.
+*
+*/
+#ifndef HOST_ROM_H
+#define HOST_ROM_H
+
+#include <string.h>
+#include <stdio.h>
+
+typedef unsigned char       UINT8;
+typedef unsigned short      UINT16;
+typedef unsigned int        UINT32;
+typedef signed char         INT8;
+typedef signed short        INT16;
+typedef signed int          INT32;
+typedef unsigned int        BOOL;
+typedef UINT8               BD_ADDR[6];
+
+#define TRUE                1
+#define FALSE               0
+#define PACKED
+
+/******************************************************
+ *                  HCI and controller
+ ******************************************************/
+#define HCIULP_MAX_DATA_LENGTH                              31
+
+#define HCIULP_PUBLIC_ADDRESS                               0
+#define HCIULP_ACTIVE_SCAN                                  1
+#define HCIULP_SCAN_DUPLICATE_FILTER_OFF                    0
+#define HCIULP_SCAN_DUPLICATE_FILTER_ON                     1
+#define HCIULP_SCAN_FILTER_POLICY_ACCEPT_LIST_NOT_USED      0
+#define HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_NOT_USED 0
+#define HCIULP_INITIATOR_FILTER_POLICY_ACCEPT_LIST_USED     1
+
+#define BT_ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST   0x16
+
+// advertisement report with the data
+typedef struct
+{
+    UINT8   eventType;
+    UINT8   addressType;
+    BD_ADDR wd_addr;
+    UINT8   dataLen;
+    UINT8   data[HCIULP_MAX_DATA_LENGTH];
+    INT8    rssi;
+} HCIULP_ADV_PACKET_REPORT_WDATA;
+
+// event header, parameters follow
+typedef struct
+{
+    UINT8   code;
+    UINT8   len;
+} HCI_EVT_HDR;
+
+/******************************************************
+ *                  Connection info and SMP
+ ******************************************************/
+typedef struct
+{
+    UINT8   role;
+    UINT16  connHandle;
+    BD_ADDR peerAddress;
+} EMCONINFO_DEVINFO;
+
+typedef struct
+{
+    UINT8   smpRole;
+    UINT8   state;
+} LESMP_INFO;
+
+typedef UINT8 LESMP_PARING_RESULT;
+typedef void (*LESMP_SINGLE_PARAM_CB)(LESMP_PARING_RESULT result);
+
+#define LESMP_ROLE_INITIATOR                                0
+#define LESMP_ROLE_RESPONDERS                               1
+#define LESMP_CODE_SECURITY_REQ                             0x0b
+#define LESMP_PAIRING_RESULT_BONDED                         0
+#define LESMP_IO_CAP_DISP_NO_IO                             3
+#define LESMP_OOB_AUTH_DATA_NOT_PRESENT                     0
+#define LESMP_AUTH_FLAG_BONDING                             1
+#define LESMP_MAX_KEY_SIZE                                  16
+#define LESMP_KEY_DISTRIBUTION_ENC_KEY                      0x01
+#define LESMP_KEY_DISTRIBUTION_ID_KEY                       0x02
+#define LESMP_KEY_DISTRIBUTION_SIGN_KEY                     0x04
+
+extern LESMP_INFO *lesmp_pinfo;
+
+void  *emconinfo_getPtr(void);
+UINT16 emconinfo_getConnHandle(void);
+UINT8  emconinfo_getDiscReason(void);
+void  *emconninfo_getPeerAddr(void);
+void  *emconninfo_getPeerPubAddr(void);
+
+void  *lesmp_getPtr(void);
+void   lesmp_setPtr(void *p);
+void   lesmp_startPairing(void *p);
+void   lesmp_regSMPResultCb(LESMP_SINGLE_PARAM_CB cb);
+void   lesmp_setPairingParam(UINT8 io_cap, UINT8 oob, UINT8 auth_req, UINT8 max_key_size,
+                             UINT8 init_key_distrib, UINT8 resp_key_distrib);
+void   lesmpkeys_removeAllBondInfo(void);
+
+/******************************************************
+ *                  L2CAP
+ ******************************************************/
+typedef struct
+{
+    UINT16  len;
+    UINT16  cid;
+} LEL2CAP_HDR;
+
+typedef void (*LEL2CAP_L2CAPHANDLER)(UINT8 *l2capHdr);
+
+void   lel2cap_regConnLessHandler(UINT16 cid, LEL2CAP_L2CAPHANDLER handler);
+void   lel2cap_sendConnParamUpdateReq(UINT16 min_interval, UINT16 max_interval, UINT16 latency, UINT16 timeout);
+void   lesmp_l2capHandler(LEL2CAP_HDR *l2capHdr);
+
+/******************************************************
+ *                  ATT and GATT database
+ ******************************************************/
+#define LEATT_ATT_MTU                                       23
+
+typedef void (*LEATT_TRIPLE_PARAM_CB)(int len, int attr_len, UINT8 *data);
+typedef void (*LEATT_NO_PARAM_CB)(void);
+
+// attribute written by the peer
+typedef struct
+{
+    UINT16  handle;
+    UINT16  len;
+    UINT8  *value;
+} LEGATTDB_ENTRY_HDR;
+
+typedef int (*LEGATTDB_WRITE_CB)(LEGATTDB_ENTRY_HDR *p);
+
+#define LEGATTDB_CHAR_PROP_READ                             0x02
+#define LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE                0x04
+#define LEGATTDB_CHAR_PROP_WRITE                            0x08
+#define LEGATTDB_CHAR_PROP_NOTIFY                           0x10
+#define LEGATTDB_CHAR_PROP_INDICATE                         0x20
+
+#define LEGATTDB_PERM_READABLE                              0x01
+#define LEGATTDB_PERM_WRITE_CMD                             0x02
+#define LEGATTDB_PERM_WRITE_REQ                             0x04
+#define LEGATTDB_PERM_AUTH_READABLE                         0x08
+#define LEGATTDB_PERM_AUTH_WRITABLE                         0x40
+#define LEGATTDB_PERM_VARIABLE_LENGTH                       0x80
+
+#define UUID_ATTRIBUTE_PRIMARY_SERVICE                      0x2800
+#define UUID_ATTRIBUTE_CHARACTERISTIC                       0x2803
+#define UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION 0x2902
+#define UUID_SERVICE_GAP                                    0x1800
+#define UUID_SERVICE_GATT                                   0x1801
+#define UUID_SERVICE_DEVICE_INFORMATION                     0x180a
+#define UUID_SERVICE_BATTERY                                0x180f
+#define UUID_CHARACTERISTIC_DEVICE_NAME                     0x2a00
+#define UUID_CHARACTERISTIC_APPEARANCE                      0x2a01
+#define UUID_CHARACTERISTIC_BATTERY_LEVEL                   0x2a19
+#define UUID_CHARACTERISTIC_SYSTEM_ID                       0x2a23
+#define UUID_CHARACTERISTIC_MODEL_NUMBER_STRING             0x2a24
+#define UUID_CHARACTERISTIC_MANUFACTURER_NAME_STRING        0x2a29
+
+#define APPEARANCE_GENERIC_TAG                              512
+#define ADV_SERVICE_UUID128_COMP                            0x07
+
+#define CCC_NOTIFICATION                                    0x01
+#define CCC_INDICATION                                      0x02
+
+#define BIT16_TO_8(val)                                     (UINT8)((val) & 0xff), (UINT8)(((val) >> 8) & 0xff)
+
+// database entries are handle, permission, length and the value
+#define PRIMARY_SERVICE_UUID16(handle, uuid) \
+    BIT16_TO_8(handle), LEGATTDB_PERM_READABLE, 4, \
+    BIT16_TO_8(UUID_ATTRIBUTE_PRIMARY_SERVICE), BIT16_TO_8(uuid)
+#define PRIMARY_SERVICE_UUID128(handle, uuid) \
+    BIT16_TO_8(handle), LEGATTDB_PERM_READABLE, 18, \
+    BIT16_TO_8(UUID_ATTRIBUTE_PRIMARY_SERVICE), uuid
+#define CHARACTERISTIC_UUID16(handle, handle_value, uuid, properties, permission, value_len) \
+    BIT16_TO_8(handle), LEGATTDB_PERM_READABLE, 7, \
+    BIT16_TO_8(UUID_ATTRIBUTE_CHARACTERISTIC), properties, BIT16_TO_8(handle_value), BIT16_TO_8(uuid), \
+    BIT16_TO_8(handle_value), permission, value_len
+#define CHARACTERISTIC_UUID128_WRITABLE(handle, handle_value, uuid, properties, permission, value_len) \
+    BIT16_TO_8(handle), LEGATTDB_PERM_READABLE, 21, \
+    BIT16_TO_8(UUID_ATTRIBUTE_CHARACTERISTIC), properties, BIT16_TO_8(handle_value), uuid, \
+    BIT16_TO_8(handle_value), permission, value_len, value_len
+#define CHAR_DESCRIPTOR_UUID16_WRITABLE(handle, uuid, permission, value_len) \
+    BIT16_TO_8(handle), permission, value_len, value_len, BIT16_TO_8(uuid)
+
+UINT16 legattdb_getHandle(LEGATTDB_ENTRY_HDR *p);
+int    legattdb_getAttrValueLen(LEGATTDB_ENTRY_HDR *p);
+UINT8 *legattdb_getAttrValue(LEGATTDB_ENTRY_HDR *p);
+void   legattdb_regWriteHandleCb(LEGATTDB_WRITE_CB cb);
+void   legattdb_dumpDb(void);
+
+void   leatt_regNotificationCb(LEATT_TRIPLE_PARAM_CB cb);
+void   leatt_regIndicationCb(LEATT_TRIPLE_PARAM_CB cb);
+void   leatt_regReadRspCb(LEATT_TRIPLE_PARAM_CB cb);
+void   leatt_regReadByTypeRspCb(LEATT_TRIPLE_PARAM_CB cb);
+void   leatt_regReadByGroupTypeRspCb(LEATT_TRIPLE_PARAM_CB cb);
+void   leatt_regWriteRspCb(LEATT_NO_PARAM_CB cb);
+
+/******************************************************
+ *                  Connection mux
+ ******************************************************/
+typedef void (*BLECM_FUNC_WITH_PARAM)(void *param);
+
+#define BLECM_APP_EVT_LINK_UP                               0
+#define BLECM_APP_EVT_LINK_DOWN                             1
+#define BLECM_DBGUART_LOG                                   0x01
+#define BLECM_DBGUART_LOG_L2CAP                             0x02
+#define BLECM_DBGUART_LOG_SMP                               0x04
+
+void   blecm_ConMuxInit(int num);
+void   blecm_enableConMux(void);
+void   blecm_enablescatternet(void);
+int    blecm_FindFreeConMux(void);
+void   blecm_AddConMux(int index, UINT16 con_handle, int db_size, void *db, void *dev_info, void *smp_info);
+void   blecm_DelConMux(int index);
+void   blecm_SetPtrConMux(UINT16 con_handle);
+int    blecm_getAvailableTxBuffers(void);
+void   blecm_disconnect(UINT8 reason);
+void   blecm_setAdvDuringConnEnable(BOOL enable);
+void   blecm_clearWhiteList(void);
+void   blecm_addWhiteList(UINT8 addr_type, UINT8 *bdaddr);
+void   blecm_RegleAdvReportCb(BLECM_FUNC_WITH_PARAM cb);
+void   blecm_regEncryptionChangedHandler(void (*cb)(HCI_EVT_HDR *evt));
+
+/******************************************************
+ *                  Central
+ ******************************************************/
+#define NO_SCAN                                             0
+#define HIGH_SCAN                                           1
+#define LOW_SCAN                                            2
+
+#define NO_CONN                                             0
+#define HIGH_CONN                                           1
+#define LOW_CONN                                            2
+
+typedef struct
+{
+    UINT8   scan_type;
+    UINT8   scan_adr_type;
+    UINT8   scan_filter_policy;
+    UINT8   filter_duplicates;
+    UINT8   init_filter_policy;
+    UINT8   init_addr_type;
+    UINT16  high_scan_interval;
+    UINT16  low_scan_interval;
+    UINT16  high_scan_window;
+    UINT16  low_scan_window;
+    UINT16  high_scan_duration;
+    UINT16  low_scan_duration;
+    UINT16  high_conn_min_interval;
+    UINT16  low_conn_min_interval;
+    UINT16  high_conn_max_interval;
+    UINT16  low_conn_max_interval;
+    UINT16  high_conn_latency;
+    UINT16  low_conn_latency;
+    UINT16  high_supervision_timeout;
+    UINT16  low_supervision_timeout;
+    UINT16  conn_min_event_len;
+    UINT16  conn_max_event_len;
+} BLE_CEN_CFG;
+
+void   blecen_Create(void);
+void   blecen_Scan(UINT8 mode);
+UINT8  blecen_GetScan(void);
+void   blecen_Conn(UINT8 mode, UINT8 *bdaddr, UINT8 addr_type);
+UINT8  blecen_GetConn(void);
+void   blecen_appTimerCb(UINT32 arg);
+void   blecen_connDown(void);
+void   blecen_leAdvReportCb(HCIULP_ADV_PACKET_REPORT_WDATA *evt);
+void   blecen_encryptionChanged(HCI_EVT_HDR *evt);
+void   blecen_smpBondResult(LESMP_PARING_RESULT result);
+void   blecli_ClientHandleReset(void);
+
+/******************************************************
+ *                  Profile and application
+ ******************************************************/
+#define LOCAL_NAME_LEN_MAX                                  16
+#define COD_LEN                                             3
+#define VERSION_LEN                                         5
+#define HANDLE_NUM_MAX                                      5
+#define GPIO_NUM_MAX                                        16
+
+#define NO_DISCOVERABLE                                     0
+#define HIGH_UNDIRECTED_DISCOVERABLE                        3
+
+#define SECURITY_ENABLED                                    0x01
+#define SECURITY_REQUEST                                    0x02
+
+#define BLEPROFILE_GENERIC_APP_TIMER                        0x00
+#define BLEAPP_APP_TIMER_SCAN                               0x10
+#define BLEAPP_APP_TIMER_CONN                               0x11
+
+typedef void (*BLEAPP_TIMER_CB)(UINT32 arg);
+
+typedef struct
+{
+    UINT16  fine_timer_interval;
+    UINT8   default_adv;
+    UINT8   button_adv_toggle;
+    UINT16  high_undirect_adv_interval;
+    UINT16  low_undirect_adv_interval;
+    UINT16  high_undirect_adv_duration;
+    UINT16  low_undirect_adv_duration;
+    UINT16  high_direct_adv_interval;
+    UINT16  low_direct_adv_interval;
+    UINT16  high_direct_adv_duration;
+    UINT16  low_direct_adv_duration;
+    char    local_name[LOCAL_NAME_LEN_MAX];
+    char    cod[COD_LEN];
+    char    ver[VERSION_LEN];
+    UINT8   encr_required;
+    UINT8   disc_required;
+    UINT8   test_enable;
+    UINT8   tx_power_level;
+    UINT8   con_idle_timeout;
+    UINT8   powersave_timeout;
+    UINT16  hdl[HANDLE_NUM_MAX];
+    UINT16  serv[HANDLE_NUM_MAX];
+    UINT16  cha[HANDLE_NUM_MAX];
+    UINT8   findme_locator_enable;
+    UINT8   findme_alert_level;
+    UINT8   client_grouptype_enable;
+    UINT8   linkloss_button_enable;
+    UINT8   pathloss_check_interval;
+    UINT8   alert_interval;
+    UINT8   high_alert_num;
+    UINT8   mild_alert_num;
+    UINT8   status_led_enable;
+    UINT8   status_led_interval;
+    UINT8   status_led_con_blink;
+    UINT8   status_led_dir_adv_blink;
+    UINT8   status_led_un_adv_blink;
+    UINT16  led_on_ms;
+    UINT16  led_off_ms;
+    UINT16  buz_on_ms;
+    UINT16  button_power_timeout;
+    UINT16  button_client_timeout;
+    UINT16  button_discover_timeout;
+    UINT16  button_filter_timeout;
+} BLE_PROFILE_CFG;
+
+typedef struct
+{
+    UINT32  baudrate;
+    UINT8   txpin;
+    UINT8   rxpin;
+} BLE_PROFILE_PUART_CFG;
+
+typedef struct
+{
+    INT8    gpio_pin[GPIO_NUM_MAX];
+    UINT16  gpio_flag[GPIO_NUM_MAX];
+} BLE_PROFILE_GPIO_CFG;
+
+// value written to the GATT database
+typedef struct
+{
+    UINT8   len;
+    UINT8   header;
+    UINT8   pdu[LEATT_ATT_MTU - 1];
+} BLEPROFILE_DB_PDU;
+
+#define PUARTENABLE                                         0x80
+#define GPIO_PIN_UART_TX                                    32
+#define GPIO_PIN_UART_RX                                    33
+#define GPIO_PIN_WP                                         1
+#define GPIO_PIN_BUTTON                                     0
+#define GPIO_PIN_LED                                        14
+#define GPIO_PIN_BATTERY                                    15
+#define GPIO_PIN_BUZZER                                     28
+#define GPIO_SETTINGS_WP                                    0x0001
+#define GPIO_SETTINGS_BUTTON                                0x0002
+#define GPIO_SETTINGS_LED                                   0x0004
+#define GPIO_SETTINGS_BATTERY                               0x0008
+#define GPIO_SETTINGS_BUZZER                                0x0010
+#define GPIO_BOTHEDGE_INT                                   0x0100
+
+extern BLE_PROFILE_CFG      *bleprofile_p_cfg;
+extern BLE_PROFILE_GPIO_CFG *bleprofile_gpio_p_cfg;
+
+void   bleapp_set_cfg(UINT8 *db, int db_size, void *cfg, void *puart_cfg, void *gpio_cfg, void (*create)(void));
+void   bleprofile_Init(BLE_PROFILE_CFG *cfg);
+void   bleprofile_GPIOInit(BLE_PROFILE_GPIO_CFG *cfg);
+void   bleprofile_regAppEvtHandler(UINT8 evt, void (*cb)(void));
+void   bleprofile_regIntCb(UINT32 (*cb)(UINT32 value));
+void   bleprofile_regTimerCb(BLEAPP_TIMER_CB fine_cb, BLEAPP_TIMER_CB cb);
+void   bleprofile_StartTimer(void);
+void   bleprofile_KillTimer(void);
+void   bleprofile_Discoverable(UINT8 mode, UINT8 *bdaddr);
+int    bleprofile_ReadNVRAM(UINT8 id, UINT8 len, UINT8 *buf);
+int    bleprofile_WriteNVRAM(UINT8 id, UINT8 len, UINT8 *buf);
+BOOL   bleprofile_DeleteNVRAM(UINT8 id);
+void   bleprofile_WriteHandle(UINT16 handle, BLEPROFILE_DB_PDU *p_pdu);
+void   bleprofile_sendNotification(UINT16 handle, UINT8 *data, int len);
+void   bleprofile_sendIndication(UINT16 handle, UINT8 *data, int len, void (*cb)(void));
+void   bleprofile_sendHandleValueConf(void);
+void   bleprofile_sendWriteCmd(UINT16 handle, UINT8 *data, int len);
+void   bleprofile_sendWriteReq(UINT16 handle, UINT8 *data, int len);
+void   bleprofile_sendReadByGroupTypeReq(UINT16 start_handle, UINT16 end_handle, UINT16 uuid);
+void   bleprofile_sendReadByTypeReq(UINT16 start_handle, UINT16 end_handle, UINT16 uuid);
+
+/******************************************************
+ *                  Platform
+ ******************************************************/
+typedef enum
+{
+    LOW_POWER_MODE_POLL_TYPE_SLEEP,
+    LOW_POWER_MODE_POLL_TYPE_POWER_OFF,
+} LowPowerModePollType;
+
+void   devlpm_registerForLowPowerQueries(UINT32 (*cb)(LowPowerModePollType type, UINT32 context), UINT32 context);
+void   wdog_restart(void);
+
+void   ble_trace0(const char *fmt);
+void   ble_trace1(const char *fmt, UINT32 a);
+void   ble_trace2(const char *fmt, UINT32 a, UINT32 b);
+void   ble_trace3(const char *fmt, UINT32 a, UINT32 b, UINT32 c);
+void   ble_trace4(const char *fmt, UINT32 a, UINT32 b, UINT32 c, UINT32 d);
+void   ble_tracen(char *p, int len);
+
+#define APPLICATION_INIT()                  void application_init(void)
+#define BLE_APP_ENABLE_TRACING_ON_PUART()
+
+#endif